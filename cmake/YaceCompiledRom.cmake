@@ -0,0 +1,18 @@
+# yace_add_compiled_rom(<name> TARGET <target> ROM <path>)
+#
+# Translates a CHIP-8 program with RomCompiler and adds the generated source to <target>. The compiled blocks are used
+# by chip8 when engine::compiled is selected and the loaded program matches the ROM byte for byte.
+function(yace_add_compiled_rom NAME)
+   cmake_parse_arguments(COMPILED_ROM "" "TARGET;ROM" "" ${ARGN})
+   if (NOT COMPILED_ROM_TARGET OR NOT COMPILED_ROM_ROM)
+      message(FATAL_ERROR "yace_add_compiled_rom: TARGET and ROM are required")
+   endif()
+
+   set(OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${NAME}.cpp")
+   add_custom_command(
+      OUTPUT ${OUTPUT}
+      COMMAND RomCompiler ${COMPILED_ROM_ROM} ${NAME} ${OUTPUT}
+      DEPENDS RomCompiler ${COMPILED_ROM_ROM}
+      COMMENT "Compiling ROM ${NAME}")
+   target_sources(${COMPILED_ROM_TARGET} PRIVATE ${OUTPUT})
+endfunction()
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include "Yace/chip8.hpp"
+#include "Yace/loader.hpp"
+
+// Runs a program without a window and prints the final display, e.g. Headless resources/BRIX 1000000 recompiler cosmac
+int main(int argc, char* argv[])
+{
+    const std::string file_path = argc > 1 ? argv[1] : "resources/TICTAC";
+    const uint64_t cycles = argc > 2 ? std::stoull(argv[2]) : 1000000;
+    const std::string engine = argc > 3 ? argv[3] : "interpreter";
+    const std::string quirks = argc > 4 ? argv[4] : "yace";
+
+    try
+    {
+        ye::chip8 chip8;
+        if (engine == "recompiler")
+            chip8.set_engine(ye::engine::recompiler);
+        else if (engine != "interpreter")
+            throw std::runtime_error("Headless: Unknown engine " + engine + ".");
+        if (quirks == "cosmac")
+            chip8.set_quirks(ye::quirks_profile::cosmac);
+        else if (quirks == "superchip")
+            chip8.set_quirks(ye::quirks_profile::superchip);
+        else if (quirks != "yace")
+            throw std::runtime_error("Headless: Unknown quirks " + quirks + ".");
+        chip8.load(ye::load_resource(file_path));
+
+        const auto start_time = std::chrono::steady_clock::now();
+        chip8.run_cycles(cycles);
+        const auto end_time = std::chrono::steady_clock::now();
+
+        for (uint32_t y = 0; y < ye::chip8::height; ++y)
+        {
+            for (uint32_t x = 0; x < ye::chip8::width; ++x)
+                putchar(chip8.get_pixel(y * ye::chip8::width + x) != 0 ? '#' : '.');
+            putchar('\n');
+        }
+
+        const auto seconds = std::chrono::duration<double>(end_time - start_time).count();
+        printf("%llu instructions in %.3f s (%.1f MIPS)\n",
+            static_cast<unsigned long long>(chip8.get_cycles()),
+            seconds,
+            seconds > 0 ? chip8.get_cycles() / seconds / 1e6 : 0.0);
+    }
+    catch (std::exception const& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,6 +1,6 @@
 #include "Yace/yace.hpp"
 
-void update(ye::chip8 const&)
+void update(ye::chip8&)
 {
 }
 
@@ -8,7 +8,7 @@ int main()
 {
     const uint32_t width = YACE_SCREEN_WIDTH * 10;
     const uint32_t height = YACE_SCREEN_HEIGHT * 10;
-    const uint32_t framerate = YACE_FRAMERATE * 100;
+    const uint32_t framerate = YACE_FRAMERATE;
     const std::string title = "TICTAC - Yace Application";
     const std::string file_path = "resources/TICTAC";
 
@@ -5,7 +5,7 @@
 
 namespace
 {
-    void update(ye::chip8 const& chip8);
+    void update(ye::chip8& chip8);
 
     std::unique_ptr<tic_tac> tic_Tac;
 }
@@ -19,7 +19,9 @@ int main()
             YACE_SCREEN_WIDTH * 10,
             YACE_SCREEN_HEIGHT * 10,
             "TicTacToe - Yace Application",
-            YACE_FRAMERATE * 100);
+            YACE_FRAMERATE,
+            YACE_CLOCK_RATE * 10,
+            ye::engine::compiled);
     YACE_APPLICATION.run("resources/TICTAC", std::bind(&update, std::placeholders::_1));
     YACE_APPLICATION.terminate();
 
@@ -28,7 +30,7 @@ int main()
 
 namespace
 {
-    void update(ye::chip8 const& chip8)
+    void update(ye::chip8& chip8)
     {
         tic_Tac->play(chip8);
     }
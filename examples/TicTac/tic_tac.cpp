@@ -27,18 +27,9 @@ namespace priv
     std::array<uint32_t, 9> chip8_x_positions = {341, 349, 357, 853, 861, 869, 1365, 1373, 1381};
 }
 
-std::array<ye::key, 9> tic_tac::tic_tac_keys =
-{
-    ye::key::one,
-    ye::key::two,
-    ye::key::three,
-    ye::key::q,
-    ye::key::w,
-    ye::key::e,
-    ye::key::a,
-    ye::key::s,
-    ye::key::d,
-};
+std::array<uint8_t, 9> tic_tac::tic_tac_keys = {0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9};
+
+uint8_t const tic_tac::clear_board_key = 0xA;
 
 tic_tac::tic_tac() :
     marked_(false),
@@ -63,7 +54,7 @@ void tic_tac::start()
     player_o_.start_game();
 }
 
-void tic_tac::play(ye::chip8 const& chip8)
+void tic_tac::play(ye::chip8& chip8)
 {
     chip8_ = &chip8;
     auto const& board = get_board();
@@ -112,17 +103,14 @@ void tic_tac::play(ye::chip8 const& chip8)
     {
         if (wait_clear_board_)
         {
-            auto& keyboard = YACE_WINDOW.get_keyboard();
-
             if (game_state == game_state::new_)
             {
-                if (keyboard.is_key_pressed(ye::key::z))
-                    keyboard.release(ye::key::z);
+                chip8_->set_keys(0);
                 wait_clear_board_ = false;
             }
             else
             {
-                keyboard.press(ye::key::z);
+                chip8_->set_keys(static_cast<uint16_t>(1 << clear_board_key));
 
                 return;
             }
@@ -170,13 +158,11 @@ bool tic_tac::try_mark(const uint32_t position) const
 {
     if (!priv::is_pressed(*chip8_, position))
     {
-        for (auto const default_key : tic_tac_keys)
-            YACE_WINDOW.get_keyboard().release(default_key);
-        YACE_WINDOW.get_keyboard().press(tic_tac_keys[position]);
+        chip8_->set_keys(static_cast<uint16_t>(1 << tic_tac_keys[position]));
 
         return false;
     }
-    YACE_WINDOW.get_keyboard().release(tic_tac_keys[position]);
+    chip8_->set_keys(0);
 
     return true;
 }
@@ -191,9 +177,9 @@ std::array<cell_state, 9> tic_tac::get_board() const
     std::array<cell_state, 9> board{};
 
     for (size_t i = 0; i < 9; ++i)
-        if (chip8_->graphics[priv::chip8_o_positions[i]] == 1)
+        if (chip8_->get_pixel(priv::chip8_o_positions[i]) == 1)
             board[i] = cell_state::o;
-        else if (chip8_->graphics[priv::chip8_x_positions[i]] == 1)
+        else if (chip8_->get_pixel(priv::chip8_x_positions[i]) == 1)
             board[i] = cell_state::x;
         else
             board[i] = cell_state::empty;
@@ -205,6 +191,6 @@ namespace priv
 {
     bool is_pressed(ye::chip8 const& chip8, uint32_t const position)
     {
-        return chip8.graphics[chip8_o_positions[position]] == 1 || chip8.graphics[chip8_x_positions[position]] == 1;
+        return chip8.get_pixel(chip8_o_positions[position]) == 1 || chip8.get_pixel(chip8_x_positions[position]) == 1;
     }
 }
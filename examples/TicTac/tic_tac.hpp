@@ -24,13 +24,15 @@ enum class game_state
 class tic_tac : public ye::non_copyable
 {
 public:
-    static std::array<ye::key, 9> tic_tac_keys;
+    static std::array<uint8_t, 9> tic_tac_keys; // CHIP-8 key marking each cell
+
+    static uint8_t const clear_board_key;
 
     tic_tac();
 
     void start();
 
-    void play(ye::chip8 const& chip8);
+    void play(ye::chip8& chip8);
 
     bool try_mark(uint32_t position) const;
 
@@ -53,7 +55,7 @@ private:
 
     player player_o_;
 
-    ye::chip8 const* chip8_;
+    ye::chip8* chip8_;
 };
 
 #endif
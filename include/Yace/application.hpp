@@ -1,15 +1,20 @@
 #ifndef YACE_APPLICATION_HPP
 #define YACE_APPLICATION_HPP
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
 #include "Yace/config.hpp"
+#include "Yace/engine.hpp"
 #include "Yace/non_copyable.hpp"
+#include "Yace/triple_buffer.hpp"
 
 namespace ye
 {
     class chip8;
+    class frame_pacer;
     class graphics;
     class window;
 
@@ -22,9 +27,14 @@ namespace ye
             uint32_t width = YACE_SCREEN_WIDTH,
             uint32_t height = YACE_SCREEN_HEIGHT,
             std::string const& title = "Yace Application",
-            uint32_t framerate = YACE_FRAMERATE);
+            uint32_t framerate = YACE_FRAMERATE,
+            uint32_t clock_rate = YACE_CLOCK_RATE,
+            engine engine = engine::interpreter);
 
-        void run(std::string const& file_path, std::function<void(chip8 const& chip8)> const& update) const;
+        // The core runs on a thread of its own, the calling thread handles the window and renders. update, if any, is
+        // called on the emulation thread after every batch of cycles, and once a frame while the core waits for a key,
+        // and may drive the keys through chip8::set_keys().
+        void run(std::string const& file_path, std::function<void(chip8& chip8)> const& update) const;
 
         void terminate();
 
@@ -35,16 +45,23 @@ namespace ye
 
         ~application();
 
+        using frame = std::array<uint64_t, 32>;
+
         bool glfw_initialized_;
 
-        void render() const;
+        // Uploads the rows of the latest published frame that are set in pending_rows, false if there were none
+        bool upload_frame(triple_buffer<frame>& frames, std::atomic<uint32_t>& pending_rows) const;
 
         void play_beep() const;
 
         uint32_t framerate_;
 
+        uint32_t clock_rate_;
+
         std::unique_ptr<chip8> chip8_;
 
+        std::unique_ptr<frame_pacer> frame_pacer_;
+
         std::unique_ptr<graphics> graphics_;
 
         std::unique_ptr<window> window_;
@@ -2,12 +2,23 @@
 #define YACE_CHIP8_HPP
 
 #include <array>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include "Yace/config.hpp"
+#include "Yace/engine.hpp"
 #include "Yace/non_copyable.hpp"
+#include "Yace/paged_memory.hpp"
+#include "Yace/quirks.hpp"
+#include "Yace/state.hpp"
+#include "Yace/stop_condition.hpp"
 
 namespace ye
 {
+    class compiled_program;
+
+    class recompiler;
+
     class YACE_API chip8 : public non_copyable
     {
     public:
@@ -17,38 +28,281 @@ namespace ye
 
         chip8();
 
+        ~chip8();
+
         void load(std::vector<uint8_t> const& buffer);
 
         void emulate_cycle();
 
+        void run_cycles(uint64_t cycles);
+
+        stop_reason run_until(stop_condition const& condition);
+
+        uint64_t get_cycles() const;
+
+        bool is_waiting_for_key() const; // parked on Fx0A until a key is pressed
+
+        uint16_t get_keys() const; // bit k is set while key k is held
+
+        // Holds exactly the given keys from the next cycle on, dropping the releases tap_key() scheduled
+        void set_keys(uint16_t keys);
+
+        // Holds the key for the next given number of cycles and releases it right after, whatever the runs in between
+        void tap_key(uint8_t key, uint64_t cycles);
+
+        uint8_t get_sound_timer() const;
+
+        uint32_t get_clock_rate() const;
+
+        void set_clock_rate(uint32_t clock_rate);
+
+        // Cores start from a random seed, the same seed makes a core draw the same Cxkk numbers again
+        void seed(uint64_t seed);
+
         uint16_t get_opcode() const;
 
+        engine get_engine() const;
+
+        void set_engine(engine engine);
+
+        quirks_profile get_quirks() const;
+
+        void set_quirks(quirks_profile quirks);
+
+        // States include the held keys and the pending taps, loading one resumes the input where it was saved
+        void save_state(state& state) const;
+
+        void load_state(state const& state);
+
+        std::array<uint64_t, 32> const& get_graphics() const;
+
+        uint8_t get_pixel(uint32_t index) const; // index = y * width + x
+
         bool redraw_flag;
 
+        uint32_t dirty_rows; // bit n is set when row n of graphics changed, cleared by whoever reads the rows
+
         bool sound_flag;
 
-        std::array<uint8_t, 64 * 32> graphics;
+    private:
+        friend class compiled_program;
 
-        std::array<uint8_t, 16> keys;
+        friend class recompiler;
 
-    private:
-        uint16_t opcode_;
+        struct instruction;
+
+        using handler = void (chip8::*)(instruction const& instruction);
+
+        struct instruction
+        {
+            handler execute;
+
+            uint16_t opcode;
+
+            uint16_t nnn;
+
+            uint8_t x;
+
+            uint8_t y;
+
+            uint8_t kk;
+
+            uint8_t n;
+        };
+
+        // The instructions decoded from one page of memory. Cores share the page decoded from the same bytes with the
+        // same quirks until one of them invalidates an instruction in it, like paged_memory shares its pages.
+        struct decoded_page
+        {
+            std::array<instruction, paged_memory::page_size> instructions;
+        };
+
+        // Last execution of a backward jump, compared with the next one to recognize loops that only wait
+        struct idle_loop
+        {
+            uint16_t pc; // of the jump
+
+            uint64_t cycles;
+
+            uint32_t side_effects;
+
+            uint32_t timer_reads;
+
+            std::array<uint8_t, 16> registers;
+
+            uint16_t address_register;
+
+            uint8_t stack_ptr;
+
+            std::array<uint16_t, 16> stack; // compared up to stack_ptr
+
+            uint16_t keys;
+        };
+
+        template <std::size_t Size>
+        using handler_table = std::array<handler, Size>;
+
+        struct handler_tables
+        {
+            handler_table<16> handlers; // indexed by the first nibble
+
+            handler_table<16> arithmetic_handlers; // 8xyN, indexed by the last nibble
+
+            handler_table<256> key_handlers; // ExNN, indexed by the low byte
+
+            handler_table<256> misc_handlers; // FxNN, indexed by the low byte
+        };
+
+        static std::array<handler_tables, 3> const handler_tables_; // indexed by quirks_profile
+
+        template <typename Quirks>
+        static constexpr handler_tables create_handler_tables();
+
+        template <typename Quirks>
+        static constexpr handler_table<16> create_handlers();
+
+        template <typename Quirks>
+        static constexpr handler_table<16> create_arithmetic_handlers();
+
+        static constexpr handler_table<256> create_key_handlers();
+
+        template <typename Quirks>
+        static constexpr handler_table<256> create_misc_handlers();
+
+        static handler decode_handler(handler_tables const& tables, uint16_t opcode);
+
+        instruction decode_instruction(uint16_t opcode) const;
+
+        void invalidate(uint16_t address, uint16_t size);
+
+        void decode_pages();
+
+        void decode_page(size_t index);
+
+        decoded_page& get_writable_page(size_t index);
+
+        void execute(uint64_t budget);
+
+        void execute_instruction();
+
+        uint64_t get_timer_tick() const;
+
+        uint8_t get_timer(uint64_t end) const;
+
+        void schedule_sound_timer(uint8_t value);
+
+        void run_events();
+
+        void release_keys();
+
+        void skip_idle_loop();
+
+        void decode(instruction const& instruction);
+
+        void clear_display(instruction const& instruction);
+
+        void return_from_subroutine(instruction const& instruction);
+
+        void jump(instruction const& instruction);
+
+        void call(instruction const& instruction);
+
+        void skip_if_equal_byte(instruction const& instruction);
+
+        void skip_if_not_equal_byte(instruction const& instruction);
+
+        void skip_if_equal_register(instruction const& instruction);
+
+        void load_byte(instruction const& instruction);
+
+        void add_byte(instruction const& instruction);
+
+        void load_register(instruction const& instruction);
+
+        template <typename Quirks>
+        void or_register(instruction const& instruction);
+
+        template <typename Quirks>
+        void and_register(instruction const& instruction);
+
+        template <typename Quirks>
+        void xor_register(instruction const& instruction);
+
+        void add_register(instruction const& instruction);
+
+        void sub_register(instruction const& instruction);
+
+        template <typename Quirks>
+        void shift_right(instruction const& instruction);
+
+        void subn_register(instruction const& instruction);
+
+        template <typename Quirks>
+        void shift_left(instruction const& instruction);
+
+        void skip_if_not_equal_register(instruction const& instruction);
+
+        void load_address(instruction const& instruction);
+
+        template <typename Quirks>
+        void jump_offset(instruction const& instruction);
+
+        void random(instruction const& instruction);
+
+        template <typename Quirks>
+        void draw(instruction const& instruction);
+
+        void skip_if_key_pressed(instruction const& instruction);
+
+        void skip_if_key_not_pressed(instruction const& instruction);
+
+        void load_delay_timer(instruction const& instruction);
+
+        void wait_key(instruction const& instruction);
+
+        void set_delay_timer(instruction const& instruction);
+
+        void set_sound_timer(instruction const& instruction);
+
+        void add_address(instruction const& instruction);
+
+        void load_font(instruction const& instruction);
+
+        void store_bcd(instruction const& instruction);
+
+        template <typename Quirks>
+        void store_registers(instruction const& instruction);
+
+        template <typename Quirks>
+        void load_registers(instruction const& instruction);
+
+        void invalid(instruction const& instruction);
+
+        state state_;
+
+        std::array<std::shared_ptr<decoded_page>, paged_memory::page_count> decoded_pages_;
+
+        uint32_t written_pages_; // bit n is set while page n is a copy of its own, decoded again on first execution
+
+        engine engine_;
+
+        quirks_profile quirks_;
 
-        std::array<uint8_t, 4096> memory_;
+        handler_tables const* tables_; // of the selected quirks profile
 
-        std::array<uint8_t, 16> registers_;
+        idle_loop idle_loop_;
 
-        std::array<uint16_t, 16> stack_;
+        uint64_t idle_end_; // idle loops are skipped up to this cycle, none when it has been reached
 
-        uint16_t address_register_;
+        uint32_t side_effects_; // bumped by everything whose repetition changes the state
 
-        uint16_t pc_;
+        uint32_t timer_reads_; // bumped by Fx07
 
-        uint8_t delay_timer_;
+        bool loaded_; // by load() or load_state(), a core that has neither holds no program
 
-        uint8_t sound_timer_;
+        std::unique_ptr<recompiler> recompiler_;
 
-        uint8_t stack_ptr_;
+        std::unique_ptr<compiled_program> compiled_program_;
     };
 }
 
@@ -0,0 +1,97 @@
+#ifndef YACE_COMPILED_ROM_HPP
+#define YACE_COMPILED_ROM_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include "Yace/config.hpp"
+#include "Yace/non_copyable.hpp"
+
+namespace ye
+{
+    class chip8;
+
+    // Guest state handed to the blocks generated by yace_add_compiled_rom()
+    struct compiled_context
+    {
+        uint8_t* registers;
+
+        uint16_t* address_register;
+
+        uint16_t* pc;
+
+        chip8* core;
+
+        void (*step)(chip8& core); // executes the instruction at pc through the interpreter
+
+        // Accounts for instructions executed by the block itself, opcode is the last of them
+        void (*tick)(chip8& core, uint32_t cycles, uint16_t opcode);
+    };
+
+    struct compiled_block
+    {
+        uint16_t address;
+
+        uint16_t size; // in instructions
+
+        void (*execute)(compiled_context& context);
+    };
+
+    struct compiled_rom
+    {
+        char const* name;
+
+        uint8_t const* image;
+
+        size_t image_size;
+
+        compiled_block const* blocks;
+
+        size_t block_count;
+    };
+
+    YACE_API bool register_compiled_rom(compiled_rom const& rom);
+
+    // Runs the compiled blocks of the loaded program, falling back to the interpreter wherever no block exists (e.g.
+    // computed jumps) or a block's code has been overwritten
+    class YACE_API compiled_program : public non_copyable
+    {
+    public:
+        compiled_program() = delete;
+
+        explicit compiled_program(chip8& chip8);
+
+        void execute(uint64_t budget);
+
+        void invalidate(uint16_t address, uint16_t size);
+
+        // Selects the compiled ROM matching the loaded program, if any
+        void bind();
+
+        // Puts back the blocks that were invalidated but whose code matches the ROM again, e.g. after a state of the
+        // unmodified program was loaded
+        void validate();
+
+        compiled_rom const* get_rom() const;
+
+    private:
+        static void step(chip8& chip8);
+
+        static void tick(chip8& chip8, uint32_t cycles, uint16_t opcode);
+
+        chip8& chip8_;
+
+        compiled_context context_;
+
+        compiled_rom const* rom_;
+
+        std::array<compiled_block const*, 4096> blocks_; // indexed by address
+
+        std::bitset<4096> code_; // bytes covered by a compiled block
+
+        bool invalidated_; // some block was invalidated since the last bind() or validate()
+    };
+}
+
+#endif
@@ -36,7 +36,8 @@
 #define YACE_WINDOW        YACE_APPLICATION.get_window()
 #define YACE_OPENGL_MAJOR  3
 #define YACE_OPENGL_MINOR  3
-#define YACE_FRAMERATE     60 // Chip-8 is designed to execute 60 opcodes per second
+#define YACE_FRAMERATE     60 // frames presented per second
+#define YACE_CLOCK_RATE    600 // instructions executed per second, independent of the framerate
 #define YACE_SCREEN_WIDTH  64
 #define YACE_SCREEN_HEIGHT 32
 
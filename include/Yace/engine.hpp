@@ -0,0 +1,16 @@
+#ifndef YACE_ENGINE_HPP
+#define YACE_ENGINE_HPP
+
+#include "Yace/config.hpp"
+
+namespace ye
+{
+    enum class engine
+    {
+        interpreter, // one decoded instruction per emulate_cycle()
+        recompiler, // one translated basic block per emulate_cycle(), register instructions run as x86-64 code there
+        compiled // one block compiled ahead of time by yace_add_compiled_rom() per emulate_cycle()
+    };
+}
+
+#endif
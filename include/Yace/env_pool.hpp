@@ -0,0 +1,95 @@
+#ifndef YACE_ENV_POOL_HPP
+#define YACE_ENV_POOL_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Yace/chip8.hpp"
+#include "Yace/config.hpp"
+#include "Yace/non_copyable.hpp"
+#include "Yace/state.hpp"
+
+namespace ye
+{
+    // N cores running the same program, stepped together by a fixed pool of worker threads. Each thread always steps
+    // the same contiguous chunk of cores, no windowing system is involved.
+    class YACE_API env_pool : public non_copyable
+    {
+    public:
+        env_pool() = delete;
+
+        // thread_count = 0 uses one thread per hardware thread
+        env_pool(std::vector<uint8_t> const& program, size_t size, uint64_t cycles_per_step, size_t thread_count = 0);
+
+        ~env_pool();
+
+        // Puts the given cores back to the state right after loading the program, each with a new Cxkk generator. Throws
+        // std::out_of_range for an id past size() and std::invalid_argument for an id listed more than once.
+        void reset(std::vector<size_t> const& ids);
+
+        // The generators handed out by reset() derive from this seed and the core id, so the same seed and calls
+        // replay the same episodes whatever the thread count. Pools start from a random seed.
+        void seed(uint64_t seed);
+
+        // actions[i] is the key bitmask (bit k = key k) held by core i for the whole step
+        void step(std::vector<uint16_t> const& actions);
+
+        // Display of every core as of the last reset or step
+        std::vector<std::array<uint64_t, 32>> const& observe() const;
+
+        size_t size() const;
+
+        // Throws std::out_of_range for an id past size()
+        chip8& get_core(size_t id);
+
+    private:
+        using job = std::function<void(size_t begin, size_t end)>;
+
+        void run(size_t count, job const& function);
+
+        void work(size_t worker);
+
+        size_t size_;
+
+        uint64_t cycles_per_step_;
+
+        std::unique_ptr<chip8[]> cores_;
+
+        state initial_state_;
+
+        std::vector<uint64_t> seeds_; // per core, counter drawn from to seed the core at every reset
+
+        std::vector<std::array<uint64_t, 32>> frames_;
+
+        size_t chunk_count_; // cores are split into one chunk per thread, including the calling one
+
+        std::vector<std::thread> workers_;
+
+        std::mutex mutex_;
+
+        std::condition_variable start_condition_;
+
+        std::condition_variable done_condition_;
+
+        job const* job_;
+
+        size_t job_size_;
+
+        uint64_t generation_; // incremented for every job handed to the workers
+
+        size_t pending_workers_;
+
+        std::exception_ptr error_; // first exception thrown by a worker during the current job
+
+        bool stopping_;
+    };
+}
+
+#endif
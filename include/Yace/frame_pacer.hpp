@@ -0,0 +1,49 @@
+#ifndef YACE_FRAME_PACER_HPP
+#define YACE_FRAME_PACER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include "Yace/config.hpp"
+
+namespace ye
+{
+    // Paces a loop to a fixed framerate against absolute deadlines on the monotonic clock. Most of every interval is
+    // spent asleep, only the last moments before the deadline are spun to make up for the coarse wake-ups.
+    class YACE_API frame_pacer
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct statistics
+        {
+            uint64_t frames;
+
+            uint64_t late_frames; // the deadline had passed before wait() was called
+
+            double mean_overshoot; // past the deadline when wait() returned, in microseconds
+
+            double max_overshoot; // in microseconds
+        };
+
+        frame_pacer() = delete;
+
+        explicit frame_pacer(uint32_t framerate);
+
+        // Blocks until the deadline of the current frame and moves on to the next one
+        void wait();
+
+        // Starts the deadlines over from now, e.g. after the loop was blocked on something else
+        void reset();
+
+        statistics const& get_statistics() const;
+
+    private:
+        clock::duration period_;
+
+        clock::time_point deadline_;
+
+        statistics statistics_;
+    };
+}
+
+#endif
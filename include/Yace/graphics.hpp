@@ -1,6 +1,7 @@
 #ifndef YACE_GRAPHICS_HPP
 #define YACE_GRAPHICS_HPP
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <string>
@@ -9,6 +10,8 @@
 
 namespace ye
 {
+    // Owns the state of the GL context. The program, the texture and the vertex array are bound once on creation and
+    // stay bound, the uniforms are only set when they change, so rendering is a clear and a draw.
     class YACE_API graphics : public non_copyable
     {
     public:
@@ -24,7 +27,10 @@ namespace ye
 
         uint32_t get_width() const;
 
-        void set_bitmap(std::vector<uint8_t> const& bitmap, uint32_t width, uint32_t height);
+        // rows[i] holds row y + i, one bit per pixel with the leftmost pixel in the most significant bit
+        void set_rows(uint64_t const* rows, uint32_t y, uint32_t height);
+
+        void set_colors(std::array<float, 4> const& foreground, std::array<float, 4> const& background);
 
     private:
         void create_vertex_input();
@@ -33,6 +39,8 @@ namespace ye
 
         void create_chip8_shader(std::string const& vertex, std::string const& fragment);
 
+        void bind();
+
         uint32_t height_;
 
         uint32_t width_;
@@ -51,7 +59,15 @@ namespace ye
 
         uint32_t program_id_;
 
-        std::vector<uint8_t> bitmap_;
+        int32_t foreground_location_;
+
+        int32_t background_location_;
+
+        std::vector<uint8_t> pixels_; // one byte per pixel, uploaded as GL_R8UI
+
+        std::array<float, 4> foreground_;
+
+        std::array<float, 4> background_;
     };
 }
 
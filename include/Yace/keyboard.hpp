@@ -1,7 +1,8 @@
 #ifndef YACE_KEYBOARD_HPP
 #define YACE_KEYBOARD_HPP
 
-#include <map>
+#include <atomic>
+#include <cstdint>
 #include "Yace/config.hpp"
 #include "Yace/non_copyable.hpp"
 
@@ -30,6 +31,7 @@ namespace ye
         v
     };
 
+    // The state of the 16 keys of the CHIP-8 keypad, written by the GLFW key callback and read from any thread
     class YACE_API keyboard : public non_copyable
     {
     public:
@@ -45,8 +47,10 @@ namespace ye
 
         bool is_key_pressed(key key) const;
 
+        uint16_t get_keys() const; // bit k is set while the key mapped to CHIP-8 key k is held, see chip8::set_keys()
+
     private:
-        std::map<key, bool> key_states_;
+        std::atomic<uint16_t> key_states_;
     };
 }
 
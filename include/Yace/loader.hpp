@@ -0,0 +1,14 @@
+#ifndef YACE_LOADER_HPP
+#define YACE_LOADER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Yace/config.hpp"
+
+namespace ye
+{
+    YACE_API std::vector<uint8_t> load_resource(std::string const& file_path);
+}
+
+#endif
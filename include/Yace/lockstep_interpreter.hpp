@@ -0,0 +1,212 @@
+#ifndef YACE_LOCKSTEP_INTERPRETER_HPP
+#define YACE_LOCKSTEP_INTERPRETER_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Yace/config.hpp"
+#include "Yace/non_copyable.hpp"
+#include "Yace/paged_memory.hpp"
+#include "Yace/state.hpp"
+
+namespace ye
+{
+    // Many instances of the same program laid out as a structure of arrays, one lane per instance. Lanes at the same
+    // pc decode the instruction once and execute it together, the register instructions as masked loops over all
+    // lanes that the compiler turns into vector code. Once too few lanes share a pc the batch runs lane by lane. Lanes
+    // behave like quirks_profile::yace.
+    class YACE_API lockstep_interpreter : public non_copyable
+    {
+    public:
+        lockstep_interpreter() = delete;
+
+        lockstep_interpreter(std::vector<uint8_t> const& program, size_t size);
+
+        // Puts a lane back to the state right after loading the program
+        void reset(size_t lane);
+
+        void save_state(size_t lane, state& state) const;
+
+        void load_state(size_t lane, state const& state);
+
+        // Lanes start with the generator of the scalar core that loaded the program, see chip8::seed()
+        void seed(size_t lane, uint64_t seed);
+
+        void set_keys(size_t lane, uint16_t keys); // bit k = key k
+
+        // Runs every lane for the given number of instructions
+        void run_cycles(uint64_t cycles);
+
+        std::array<uint64_t, 32> const& get_graphics(size_t lane) const;
+
+        uint64_t get_cycles(size_t lane) const;
+
+        double get_convergence() const; // lanes per decoded instruction during the last run_cycles()
+
+        size_t size() const;
+
+    private:
+        struct instruction;
+
+        using handler = void (lockstep_interpreter::*)(instruction const& instruction, size_t begin, size_t end);
+
+        struct instruction
+        {
+            handler execute;
+
+            uint16_t opcode;
+
+            uint16_t nnn;
+
+            uint8_t x;
+
+            uint8_t y;
+
+            uint8_t kk;
+
+            uint8_t n;
+        };
+
+        static handler decode_handler(uint16_t opcode);
+
+        static instruction decode_instruction(uint16_t opcode);
+
+        uint16_t fetch(size_t lane, uint16_t address) const;
+
+        instruction const& get_instruction(size_t lane, instruction& scratch) const;
+
+        bool is_written(uint16_t address) const;
+
+        void mark_written(size_t address, size_t size);
+
+        size_t select(uint16_t pc, uint16_t opcode);
+
+        void step(instruction const& instruction, size_t begin, size_t end);
+
+        void advance(size_t begin, size_t end);
+
+        uint64_t get_timer_tick(size_t lane) const;
+
+        void clear_display(instruction const& instruction, size_t begin, size_t end);
+
+        void return_from_subroutine(instruction const& instruction, size_t begin, size_t end);
+
+        void jump(instruction const& instruction, size_t begin, size_t end);
+
+        void call(instruction const& instruction, size_t begin, size_t end);
+
+        void skip_if_equal_byte(instruction const& instruction, size_t begin, size_t end);
+
+        void skip_if_not_equal_byte(instruction const& instruction, size_t begin, size_t end);
+
+        void skip_if_equal_register(instruction const& instruction, size_t begin, size_t end);
+
+        void load_byte(instruction const& instruction, size_t begin, size_t end);
+
+        void add_byte(instruction const& instruction, size_t begin, size_t end);
+
+        void load_register(instruction const& instruction, size_t begin, size_t end);
+
+        void or_register(instruction const& instruction, size_t begin, size_t end);
+
+        void and_register(instruction const& instruction, size_t begin, size_t end);
+
+        void xor_register(instruction const& instruction, size_t begin, size_t end);
+
+        void add_register(instruction const& instruction, size_t begin, size_t end);
+
+        void sub_register(instruction const& instruction, size_t begin, size_t end);
+
+        void shift_right(instruction const& instruction, size_t begin, size_t end);
+
+        void subn_register(instruction const& instruction, size_t begin, size_t end);
+
+        void shift_left(instruction const& instruction, size_t begin, size_t end);
+
+        void skip_if_not_equal_register(instruction const& instruction, size_t begin, size_t end);
+
+        void load_address(instruction const& instruction, size_t begin, size_t end);
+
+        void jump_offset(instruction const& instruction, size_t begin, size_t end);
+
+        void random(instruction const& instruction, size_t begin, size_t end);
+
+        void draw(instruction const& instruction, size_t begin, size_t end);
+
+        void skip_if_key_pressed(instruction const& instruction, size_t begin, size_t end);
+
+        void skip_if_key_not_pressed(instruction const& instruction, size_t begin, size_t end);
+
+        void load_delay_timer(instruction const& instruction, size_t begin, size_t end);
+
+        void wait_key(instruction const& instruction, size_t begin, size_t end);
+
+        void set_delay_timer(instruction const& instruction, size_t begin, size_t end);
+
+        void set_sound_timer(instruction const& instruction, size_t begin, size_t end);
+
+        void add_address(instruction const& instruction, size_t begin, size_t end);
+
+        void load_font(instruction const& instruction, size_t begin, size_t end);
+
+        void store_bcd(instruction const& instruction, size_t begin, size_t end);
+
+        void store_registers(instruction const& instruction, size_t begin, size_t end);
+
+        void load_registers(instruction const& instruction, size_t begin, size_t end);
+
+        void invalid(instruction const& instruction, size_t begin, size_t end);
+
+        size_t size_;
+
+        state initial_state_;
+
+        std::array<instruction, 4096> instructions_; // decoded from the loaded program, indexed by address
+
+        std::bitset<4096> written_; // bytes that differ from the loaded program in at least one lane
+
+        // One element per lane
+        std::array<std::vector<uint8_t>, 16> registers_; // registers_[x][lane]
+
+        std::vector<uint16_t> address_registers_;
+
+        std::vector<uint16_t> pcs_;
+
+        std::vector<uint16_t> opcodes_;
+
+        std::vector<uint8_t> stack_ptrs_;
+
+        std::vector<uint8_t> waiting_for_key_;
+
+        std::vector<uint64_t> cycles_;
+
+        std::vector<uint64_t> delay_timer_ends_;
+
+        std::vector<uint64_t> sound_timer_ends_;
+
+        std::vector<uint32_t> timer_periods_;
+
+        std::vector<uint64_t> random_states_;
+
+        std::vector<uint16_t> keys_;
+
+        std::vector<std::array<uint16_t, 16>> stacks_;
+
+        std::vector<std::array<uint64_t, 32>> graphics_;
+
+        std::vector<paged_memory> memories_;
+
+        // Scratch of run_cycles()
+        std::vector<uint8_t> mask_; // 1 for the lanes executing the current instruction
+
+        std::vector<uint64_t> ends_; // cycle at which each lane stops
+
+        uint64_t decoded_instructions_;
+
+        uint64_t executed_instructions_;
+    };
+}
+
+#endif
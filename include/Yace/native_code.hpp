@@ -0,0 +1,52 @@
+#ifndef YACE_NATIVE_CODE_HPP
+#define YACE_NATIVE_CODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "Yace/config.hpp"
+#include "Yace/non_copyable.hpp"
+#include "Yace/quirks.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define YACE_NATIVE_CODE
+#endif
+
+namespace ye
+{
+    struct state;
+
+    // x86-64 machine code for runs of register instructions (3xkk to 9xy0, Annn and Fx1E), generated by the recompiler.
+    // A run loads the V registers it uses into host registers, computes in them and stores the ones it wrote back at
+    // the end, together with pc, the opcode and the cycles. Where YACE_NATIVE_CODE isn't defined is_available() is
+    // false and the recompiler runs the portable instruction handlers only.
+    class YACE_API native_code : public non_copyable
+    {
+    public:
+        using function = void (*)(state* state);
+
+        native_code();
+
+        ~native_code();
+
+        static bool is_available();
+
+        static bool is_supported(uint16_t opcode);
+
+        // Compiles the opcodes found at address and up. count is the number of supported opcodes on entry, where only
+        // the last one may be a skip, and the number actually compiled on return. Returns nullptr when nothing was,
+        // e.g. once the code memory is full.
+        function compile(uint16_t address, uint16_t const* opcodes, size_t& count, quirks_profile quirks);
+
+        // Drops every function compiled so far
+        void clear();
+
+    private:
+        uint8_t* memory_; // executable while no compile() is writing to it
+
+        size_t size_;
+
+        size_t used_;
+    };
+}
+
+#endif
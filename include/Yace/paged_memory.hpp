@@ -0,0 +1,54 @@
+#ifndef YACE_PAGED_MEMORY_HPP
+#define YACE_PAGED_MEMORY_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Yace/config.hpp"
+
+namespace ye
+{
+    // 4 KB of guest memory split into pages that copies share until one of them writes to a page. Copying is 16
+    // reference count increments, and a forked state only owns the pages it has written since. Addresses are 12 bits,
+    // anything past the end wraps around to the start like I + n does on the original interpreter.
+    class YACE_API paged_memory
+    {
+    public:
+        static size_t const page_size = 256;
+
+        static size_t const page_count = 16;
+
+        static size_t const address_mask = page_size * page_count - 1;
+
+        paged_memory();
+
+        // Inline, this is on the path of every draw and register load
+        uint8_t operator[](size_t const address) const
+        {
+            const auto wrapped = address & address_mask;
+
+            return pages_[wrapped / page_size]->bytes[wrapped % page_size];
+        }
+
+        void write(size_t address, uint8_t value);
+
+        void write(size_t address, uint8_t const* data, size_t size);
+
+        uint8_t const* get_page(size_t index) const;
+
+        size_t size() const;
+
+    private:
+        struct page
+        {
+            std::array<uint8_t, page_size> bytes;
+        };
+
+        page& get_writable_page(size_t index);
+
+        std::array<std::shared_ptr<page>, page_count> pages_;
+    };
+}
+
+#endif
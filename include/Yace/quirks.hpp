@@ -0,0 +1,57 @@
+#ifndef YACE_QUIRKS_HPP
+#define YACE_QUIRKS_HPP
+
+#include "Yace/config.hpp"
+
+namespace ye
+{
+    // Behaviours CHIP-8 interpreters disagree on. Every profile instantiates its own handlers, chip8::set_quirks()
+    // selects the handler tables of one at runtime.
+    enum class quirks_profile
+    {
+        yace, // what this core has always done
+        cosmac, // the original COSMAC VIP interpreter
+        superchip // SUPER-CHIP 1.1 on the HP 48
+    };
+
+    struct yace_quirks
+    {
+        static constexpr bool shift_vy = false; // 8xy6/8xyE shift Vy into Vx instead of shifting Vx in place
+
+        static constexpr bool increment_address = false; // Fx55/Fx65 leave I past the last register
+
+        static constexpr bool jump_vx = false; // Bnnn is BxNN, jumping to xNN + Vx instead of nnn + V0
+
+        static constexpr bool clip_sprites = false; // sprites stop at the screen edges instead of wrapping
+
+        static constexpr bool reset_vf = false; // 8xy1/8xy2/8xy3 clear VF
+    };
+
+    struct cosmac_quirks
+    {
+        static constexpr bool shift_vy = true;
+
+        static constexpr bool increment_address = true;
+
+        static constexpr bool jump_vx = false;
+
+        static constexpr bool clip_sprites = true;
+
+        static constexpr bool reset_vf = true;
+    };
+
+    struct superchip_quirks
+    {
+        static constexpr bool shift_vy = false;
+
+        static constexpr bool increment_address = false;
+
+        static constexpr bool jump_vx = true;
+
+        static constexpr bool clip_sprites = true;
+
+        static constexpr bool reset_vf = false;
+    };
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef YACE_RANDOM_HPP
+#define YACE_RANDOM_HPP
+
+#include <cstdint>
+
+namespace ye
+{
+    // SplitMix64: a counter advanced by a fixed odd step and run through a mixing function. The counter is the whole
+    // generator, 8 bytes that live in the guest state so that every core draws its own reproducible sequence.
+    inline uint64_t mix_random(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+        return value ^ (value >> 31);
+    }
+
+    inline uint64_t next_random(uint64_t& counter)
+    {
+        counter += 0x9E3779B97F4A7C15ull;
+
+        return mix_random(counter);
+    }
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef YACE_RECOMPILER_HPP
+#define YACE_RECOMPILER_HPP
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "Yace/config.hpp"
+#include "Yace/non_copyable.hpp"
+
+namespace ye
+{
+    class chip8;
+
+    class native_code;
+
+    // Translates guest code into basic blocks and runs a whole block at a time. Blocks end at control transfers, skips,
+    // key waits and memory stores, are chained to their successors and are flushed as soon as a store hits translated
+    // code. On x86-64 runs of register instructions are compiled to machine code, see native_code.hpp, everything else
+    // and every other host runs the decoded instruction handlers.
+    class YACE_API recompiler : public non_copyable
+    {
+    public:
+        recompiler() = delete;
+
+        explicit recompiler(chip8& chip8);
+
+        ~recompiler();
+
+        void execute(uint64_t budget);
+
+        void invalidate(uint16_t address, uint16_t size);
+
+        void flush();
+
+    private:
+        struct block;
+
+        struct step;
+
+        block& find_block(uint16_t address);
+
+        block& link(block& block, uint16_t address);
+
+        std::unique_ptr<block> translate(uint16_t address);
+
+        chip8& chip8_;
+
+        std::unique_ptr<native_code> native_; // null where native code isn't available
+
+        std::unordered_map<uint16_t, std::unique_ptr<block>> blocks_;
+
+        std::bitset<4096> code_; // bytes covered by a translated block
+
+        block* next_;
+
+        bool flush_pending_;
+    };
+}
+
+#endif
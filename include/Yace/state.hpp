@@ -0,0 +1,55 @@
+#ifndef YACE_STATE_HPP
+#define YACE_STATE_HPP
+
+#include <array>
+#include <cstdint>
+#include "Yace/config.hpp"
+#include "Yace/paged_memory.hpp"
+
+namespace ye
+{
+    // Everything a running program can observe. Taking or restoring a snapshot copies the plain fields in one go and
+    // shares the memory pages, so states forked from each other only pay for the pages they wrote.
+    struct state
+    {
+        // Touched by nearly every instruction, kept together in the first cache lines
+        std::array<uint8_t, 16> registers;
+
+        uint16_t address_register;
+
+        uint16_t pc;
+
+        uint16_t opcode;
+
+        uint8_t stack_ptr;
+
+        bool waiting_for_key;
+
+        uint16_t keys; // bit k = key k held down
+
+        uint64_t cycles; // instructions executed since load
+
+        uint64_t next_event; // cycle at which run_events() is due
+
+        uint64_t delay_timer_end; // timer tick at which the delay timer reaches 0
+
+        uint64_t sound_timer_end; // timer tick at which the sound timer reaches 0
+
+        uint64_t random_state; // counter of the Cxkk generator, see random.hpp
+
+        uint32_t timer_period; // instructions per 60 Hz timer tick
+
+        uint64_t next_key_release; // earliest of key_releases, cycles are run up to it and no further at once
+
+        std::array<uint16_t, 16> stack;
+
+        std::array<uint64_t, 16> key_releases; // cycle at which a tapped key is released, the maximum for none
+
+        // Cold, only touched by draws and memory instructions
+        std::array<uint64_t, 32> graphics; // one row per element, the leftmost pixel in the most significant bit
+
+        paged_memory memory;
+    };
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef YACE_STOP_CONDITION_HPP
+#define YACE_STOP_CONDITION_HPP
+
+#include <cstdint>
+#include <optional>
+#include "Yace/config.hpp"
+
+namespace ye
+{
+    enum class stop_reason
+    {
+        cycles, // the cycle budget ran out
+        redraw, // redraw_flag is set
+        sound, // sound_flag is set
+        key_wait, // Fx0A is waiting for a key press
+        breakpoint // pc reached the breakpoint
+    };
+
+    // Conditions checked by chip8::run_until() after every instruction, or after every block with the block engines
+    struct stop_condition
+    {
+        uint64_t cycles; // instructions to execute at most
+
+        bool redraw;
+
+        bool sound;
+
+        bool key_wait;
+
+        std::optional<uint16_t> breakpoint; // executes instruction by instruction when set
+    };
+}
+
+#endif
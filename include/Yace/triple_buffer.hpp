@@ -0,0 +1,75 @@
+#ifndef YACE_TRIPLE_BUFFER_HPP
+#define YACE_TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "Yace/config.hpp"
+#include "Yace/non_copyable.hpp"
+
+namespace ye
+{
+    // Hands values from one producer thread to one consumer thread without locks. The producer fills the back buffer
+    // and publishes it, the consumer picks up the latest published buffer whenever it gets to it. Neither side ever
+    // waits for the other, a value published while the previous one was still unread replaces it.
+    template <typename T>
+    class triple_buffer : public non_copyable
+    {
+    public:
+        triple_buffer() :
+            buffers_(),
+            back_(0),
+            middle_(1),
+            front_(2)
+        {
+        }
+
+        // Producer side
+        T& get_back()
+        {
+            return buffers_[back_];
+        }
+
+        void publish()
+        {
+            back_ = middle_.exchange(static_cast<uint8_t>(back_ | fresh_bit), std::memory_order_acq_rel) & index_mask;
+        }
+
+        // Consumer side, returns false when nothing was published since the last call
+        bool update()
+        {
+            if (!is_fresh())
+                return false;
+
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+
+            return true;
+        }
+
+        bool is_fresh() const
+        {
+            return (middle_.load(std::memory_order_acquire) & fresh_bit) != 0;
+        }
+
+        T const& get_front() const
+        {
+            return buffers_[front_];
+        }
+
+    private:
+        static constexpr uint8_t index_mask = 0x3;
+
+        static constexpr uint8_t fresh_bit = 0x4; // set in middle_ by publish(), cleared by update()
+
+        std::array<T, 3> buffers_;
+
+        // Owned by the producer, the shared index and the consumer in turn, each on its own cache line
+        alignas(64) uint8_t back_;
+
+        alignas(64) std::atomic<uint8_t> middle_;
+
+        alignas(64) uint8_t front_;
+    };
+}
+
+#endif
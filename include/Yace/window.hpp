@@ -2,6 +2,7 @@
 #define YACE_WINDOW_HPP
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include "Yace/config.hpp"
 #include "Yace/non_copyable.hpp"
@@ -23,14 +24,28 @@ namespace ye
 
         keyboard& get_keyboard() const;
 
+        // Callable from any thread, the title changes on the next update()
         void set_title(std::string const& title) const;
 
+        void update() const; // main thread only, applies what other threads asked for
+
         void resize(uint32_t width, uint32_t height) const;
 
+        // Whether the contents were exposed or resized since the last call, and have to be presented again
+        bool was_damaged() const;
+
+        void damage() const;
+
     private:
         std::unique_ptr<keyboard> keyboard_;
 
         std::unique_ptr<GLFWwindow, void(*)(GLFWwindow*)> glfw_window_;
+
+        mutable std::mutex title_mutex_;
+
+        mutable std::unique_ptr<std::string> title_; // set until update() applies it
+
+        mutable bool damaged_; // only touched by the main thread
     };
 }
 
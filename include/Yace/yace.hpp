@@ -3,10 +3,24 @@
 
 #include "Yace/application.hpp"
 #include "Yace/chip8.hpp"
+#include "Yace/compiled_rom.hpp"
 #include "Yace/config.hpp"
+#include "Yace/engine.hpp"
+#include "Yace/env_pool.hpp"
+#include "Yace/frame_pacer.hpp"
 #include "Yace/graphics.hpp"
 #include "Yace/keyboard.hpp"
+#include "Yace/loader.hpp"
+#include "Yace/lockstep_interpreter.hpp"
+#include "Yace/native_code.hpp"
 #include "Yace/non_copyable.hpp"
+#include "Yace/paged_memory.hpp"
+#include "Yace/quirks.hpp"
+#include "Yace/random.hpp"
+#include "Yace/recompiler.hpp"
+#include "Yace/state.hpp"
+#include "Yace/stop_condition.hpp"
+#include "Yace/triple_buffer.hpp"
 #include "Yace/window.hpp"
 
 #endif
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "rom_compiler.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "Usage: RomCompiler <rom> <name> <output.cpp>\n");
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input.is_open())
+    {
+        fprintf(stderr, "RomCompiler: Failed to open %s.\n", argv[1]);
+        return 1;
+    }
+    input.unsetf(std::ios::skipws);
+    const std::vector<uint8_t> image((std::istream_iterator<uint8_t>(input)), std::istream_iterator<uint8_t>());
+    if (image.empty() || image.size() > 4096 - 0x200)
+    {
+        fprintf(stderr, "RomCompiler: %s is not a CHIP-8 program.\n", argv[1]);
+        return 1;
+    }
+
+    rom_compiler compiler(argv[2], image);
+    compiler.compile();
+
+    std::ofstream output(argv[3]);
+    compiler.write(output);
+    if (!output)
+    {
+        fprintf(stderr, "RomCompiler: Failed to write %s.\n", argv[3]);
+        return 1;
+    }
+
+    return 0;
+}
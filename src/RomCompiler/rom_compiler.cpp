@@ -0,0 +1,365 @@
+#include "rom_compiler.hpp"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <utility>
+
+namespace priv
+{
+    std::string hex(uint32_t value, int digits);
+
+    std::string get_register(uint32_t index);
+
+    uint16_t const program_start = 0x200;
+
+    size_t const max_block_size = 64;
+}
+
+rom_compiler::rom_compiler(std::string name, std::vector<uint8_t> image) :
+    name_(std::move(name)),
+    image_(std::move(image))
+{
+}
+
+void rom_compiler::compile()
+{
+    blocks_.clear();
+
+    std::set<uint16_t> visited;
+    std::vector<uint16_t> pending = {priv::program_start};
+    while (!pending.empty())
+    {
+        const auto address = pending.back();
+        pending.pop_back();
+        if (!is_in_image(address) || !visited.insert(address).second)
+            continue;
+
+        block block{address, {}};
+        auto current = address;
+        auto ended = false;
+        while (is_in_image(current) && block.opcodes.size() < priv::max_block_size)
+        {
+            const auto opcode = fetch(current);
+            const auto kind = classify(opcode);
+            if (kind == kind::invalid) // left to the interpreter, which reports it
+            {
+                ended = true;
+                break;
+            }
+
+            block.opcodes.push_back(opcode);
+            if (kind == kind::inline_branch || kind == kind::delegated_branch)
+            {
+                for (auto const successor : get_successors(current, opcode))
+                    pending.push_back(successor);
+                ended = true;
+                break;
+            }
+            current += 2;
+        }
+        if (!ended)
+            pending.push_back(current);
+
+        if (!block.opcodes.empty())
+            blocks_.push_back(std::move(block));
+    }
+
+    std::sort(blocks_.begin(), blocks_.end(), [](auto const& left, auto const& right)
+    {
+        return left.address < right.address;
+    });
+}
+
+void rom_compiler::write(std::ostream& stream) const
+{
+    stream << "// Generated by RomCompiler from " << name_ << ", do not edit.\n\n";
+    stream << "#include \"Yace/compiled_rom.hpp\"\n\n";
+    stream << "namespace\n{\n";
+
+    stream << "    uint8_t const image[] =\n    {";
+    for (size_t i = 0; i < image_.size(); ++i)
+        stream << (i % 16 == 0 ? "\n        " : " ") << "0x" << priv::hex(image_[i], 2) << ",";
+    stream << "\n    };\n";
+
+    for (auto const& block : blocks_)
+    {
+        stream << "\n";
+        write_block(stream, block);
+    }
+
+    stream << "\n    ye::compiled_block const blocks[] =\n    {\n";
+    for (auto const& block : blocks_)
+        stream << "        {0x" << priv::hex(block.address, 3) << ", " << block.opcodes.size() << ", &block_"
+            << priv::hex(block.address, 3) << "},\n";
+    stream << "    };\n\n";
+
+    stream << "    ye::compiled_rom const rom = {\"" << name_ << "\", image, sizeof image, blocks, sizeof blocks / sizeof "
+        "*blocks};\n\n";
+    stream << "    bool const registered = ye::register_compiled_rom(rom);\n";
+    stream << "}\n";
+}
+
+rom_compiler::kind rom_compiler::classify(uint16_t const opcode)
+{
+    switch (opcode & 0xF000)
+    {
+    case 0x0000:
+        if (opcode == 0x00E0)
+            return kind::delegated;
+        if (opcode == 0x00EE)
+            return kind::delegated_branch;
+        return kind::invalid;
+    case 0x1000:
+        return kind::inline_branch;
+    case 0x2000:
+        return kind::delegated_branch;
+    case 0x3000:
+    case 0x4000:
+        return kind::inline_branch;
+    case 0x5000:
+    case 0x9000:
+        return (opcode & 0x000F) == 0x0 ? kind::inline_branch : kind::invalid;
+    case 0x6000:
+    case 0x7000:
+    case 0xA000:
+        return kind::inline_;
+    case 0x8000:
+        switch (opcode & 0x000F)
+        {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x6:
+        case 0x7:
+        case 0xE:
+            return kind::inline_;
+        default:
+            return kind::invalid;
+        }
+    case 0xB000:
+        return kind::delegated_branch;
+    case 0xC000:
+    case 0xD000:
+        return kind::delegated;
+    case 0xE000:
+        return (opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1 ? kind::delegated_branch : kind::invalid;
+    default:
+        switch (opcode & 0x00FF)
+        {
+        case 0x1E:
+        case 0x29:
+            return kind::inline_;
+        case 0x07:
+        case 0x15:
+        case 0x18:
+        case 0x65:
+            return kind::delegated;
+        case 0x0A:
+        case 0x33: // stores may overwrite code, so the runtime gets a chance to drop stale blocks
+        case 0x55:
+            return kind::delegated_branch;
+        default:
+            return kind::invalid;
+        }
+    }
+}
+
+std::vector<uint16_t> rom_compiler::get_successors(uint16_t const address, uint16_t const opcode)
+{
+    const uint16_t next = address + 2;
+    const uint16_t skipped = address + 4;
+    const uint16_t nnn = opcode & 0x0FFF;
+
+    switch (opcode & 0xF000)
+    {
+    case 0x0000: // 00EE
+    case 0xB000:
+        return {};
+    case 0x1000:
+        return {nnn};
+    case 0x2000:
+        return {nnn, next};
+    case 0x3000:
+    case 0x4000:
+    case 0x5000:
+    case 0x9000:
+    case 0xE000:
+        return {next, skipped};
+    default: // Fx0A, Fx33, Fx55
+        return {next};
+    }
+}
+
+void rom_compiler::write_block(std::ostream& stream, block const& block) const
+{
+    stream << "    void block_" << priv::hex(block.address, 3) << "(ye::compiled_context& context)\n    {\n";
+
+    uint32_t cycles = 0;
+    uint16_t last_opcode = 0; // of the instructions tick() accounts for
+    const auto tick = [&]()
+    {
+        if (cycles > 0)
+            stream << "        context.tick(*context.core, " << cycles << ", 0x" << priv::hex(last_opcode, 4) << ");\n";
+        cycles = 0;
+    };
+
+    auto address = block.address;
+    auto ended = false;
+    for (auto const opcode : block.opcodes)
+    {
+        const auto x = priv::get_register((opcode & 0x0F00) >> 8);
+        const auto y = priv::get_register((opcode & 0x00F0) >> 4);
+
+        switch (classify(opcode))
+        {
+        case kind::inline_:
+            write_instruction(stream, address, opcode);
+            ++cycles;
+            last_opcode = opcode;
+            break;
+        case kind::inline_branch:
+            ++cycles;
+            last_opcode = opcode;
+            tick();
+            if ((opcode & 0xF000) == 0x1000)
+                stream << "        *context.pc = 0x" << priv::hex(opcode & 0x0FFF, 3) << ";\n";
+            else
+            {
+                std::string condition;
+                if ((opcode & 0xF000) == 0x3000)
+                    condition = x + " == 0x" + priv::hex(opcode & 0x00FF, 2);
+                else if ((opcode & 0xF000) == 0x4000)
+                    condition = x + " != 0x" + priv::hex(opcode & 0x00FF, 2);
+                else if ((opcode & 0xF000) == 0x5000)
+                    condition = x + " == " + y;
+                else
+                    condition = x + " != " + y;
+                stream << "        *context.pc = " << condition << " ? 0x" << priv::hex(address + 4, 3) << " : 0x"
+                    << priv::hex(address + 2, 3) << ";\n";
+            }
+            ended = true;
+            break;
+        case kind::delegated:
+        case kind::delegated_branch:
+            tick();
+            stream << "        *context.pc = 0x" << priv::hex(address, 3) << ";\n";
+            stream << "        context.step(*context.core);\n";
+            ended = classify(opcode) == kind::delegated_branch;
+            break;
+        case kind::invalid:
+            break;
+        }
+        address += 2;
+    }
+
+    if (!ended)
+    {
+        tick();
+        stream << "        *context.pc = 0x" << priv::hex(address, 3) << ";\n";
+    }
+
+    stream << "    }\n";
+}
+
+void rom_compiler::write_instruction(std::ostream& stream, uint16_t const address, uint16_t const opcode)
+{
+    const auto x = priv::get_register((opcode & 0x0F00) >> 8);
+    const auto y = priv::get_register((opcode & 0x00F0) >> 4);
+    const auto vf = priv::get_register(0xF);
+    const auto kk = "0x" + priv::hex(opcode & 0x00FF, 2);
+    const auto nnn = "0x" + priv::hex(opcode & 0x0FFF, 3);
+    const std::string i = "*context.address_register";
+
+    stream << "        // " << priv::hex(address, 3) << ": " << priv::hex(opcode, 4) << "\n";
+    switch (opcode & 0xF000)
+    {
+    case 0x6000:
+        stream << "        " << x << " = " << kk << ";\n";
+        break;
+    case 0x7000:
+        stream << "        " << x << " = static_cast<uint8_t>(" << x << " + " << kk << ");\n";
+        break;
+    case 0x8000:
+        switch (opcode & 0x000F)
+        {
+        case 0x0:
+            stream << "        " << x << " = " << y << ";\n";
+            break;
+        case 0x1:
+            stream << "        " << x << " |= " << y << ";\n";
+            break;
+        case 0x2:
+            stream << "        " << x << " &= " << y << ";\n";
+            break;
+        case 0x3:
+            stream << "        " << x << " ^= " << y << ";\n";
+            break;
+        case 0x4:
+            stream << "        " << vf << " = " << x << " + " << y << " > 0xFF ? 1 : 0;\n";
+            stream << "        " << x << " = static_cast<uint8_t>(" << x << " + " << y << ");\n";
+            break;
+        case 0x5:
+            stream << "        " << vf << " = " << x << " > " << y << " ? 1 : 0;\n";
+            stream << "        " << x << " = static_cast<uint8_t>(" << x << " - " << y << ");\n";
+            break;
+        case 0x6:
+            stream << "        " << vf << " = " << x << " & 0x01;\n";
+            stream << "        " << x << " = static_cast<uint8_t>(" << x << " >> 1);\n";
+            break;
+        case 0x7:
+            stream << "        " << vf << " = " << y << " > " << x << " ? 1 : 0;\n";
+            stream << "        " << x << " = static_cast<uint8_t>(" << y << " - " << x << ");\n";
+            break;
+        default: // 0xE
+            stream << "        " << vf << " = " << x << " >> 7;\n";
+            stream << "        " << x << " = static_cast<uint8_t>(" << x << " << 1);\n";
+            break;
+        }
+        break;
+    case 0xA000:
+        stream << "        " << i << " = " << nnn << ";\n";
+        break;
+    default:
+        if ((opcode & 0x00FF) == 0x1E)
+        {
+            stream << "        " << vf << " = " << i << " + " << x << " > 0x0FFF ? 1 : 0;\n";
+            stream << "        " << i << " = static_cast<uint16_t>(" << i << " + " << x << ");\n";
+        }
+        else // Fx29
+            stream << "        " << i << " = static_cast<uint16_t>(" << x << " * 0x5);\n";
+        break;
+    }
+}
+
+bool rom_compiler::is_in_image(uint32_t const address) const
+{
+    return address >= priv::program_start && address + 1 < priv::program_start + image_.size();
+}
+
+uint16_t rom_compiler::fetch(uint16_t const address) const
+{
+    return static_cast<uint16_t>(image_[address - priv::program_start] << 8 | image_[address - priv::program_start + 1]);
+}
+
+namespace priv
+{
+    std::string hex(uint32_t const value, int const digits)
+    {
+        std::ostringstream stream;
+        stream << std::hex << std::uppercase;
+        stream.width(digits);
+        stream.fill('0');
+        stream << value;
+
+        return stream.str();
+    }
+
+    std::string get_register(uint32_t const index)
+    {
+        return "context.registers[0x" + hex(index, 1) + "]";
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef ROMCOMPILER_ROM_COMPILER_HPP
+#define ROMCOMPILER_ROM_COMPILER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Walks the control flow of a CHIP-8 program from 0x200 and emits a C++ translation unit with one function per basic
+// block. Instructions that need more than registers (drawing, timers, keys, memory, the call stack) are executed
+// through the interpreter, and computed jumps (Bnnn, 00EE) are left for the runtime to resolve.
+class rom_compiler
+{
+public:
+    rom_compiler() = delete;
+
+    rom_compiler(std::string name, std::vector<uint8_t> image);
+
+    void compile();
+
+    void write(std::ostream& stream) const;
+
+private:
+    enum class kind
+    {
+        invalid,
+        inline_, // register-only instruction emitted as C++
+        inline_branch, // jump or skip emitted as C++, ends the block
+        delegated, // executed through the interpreter, the block continues after it
+        delegated_branch // executed through the interpreter, ends the block
+    };
+
+    struct block
+    {
+        uint16_t address;
+
+        std::vector<uint16_t> opcodes;
+    };
+
+    static kind classify(uint16_t opcode);
+
+    static std::vector<uint16_t> get_successors(uint16_t address, uint16_t opcode);
+
+    void write_block(std::ostream& stream, block const& block) const;
+
+    static void write_instruction(std::ostream& stream, uint16_t address, uint16_t opcode);
+
+    bool is_in_image(uint32_t address) const;
+
+    uint16_t fetch(uint16_t address) const;
+
+    std::string name_;
+
+    std::vector<uint8_t> image_;
+
+    std::vector<block> blocks_;
+};
+
+#endif
@@ -1,45 +1,38 @@
 #include "Yace/application.hpp"
 
-#include <array>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <fstream>
-#include <ios>
-#include <iterator>
-#include <map>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 #include "Yace/chip8.hpp"
+#include "Yace/frame_pacer.hpp"
 #include "Yace/graphics.hpp"
 #include "Yace/keyboard.hpp"
+#include "Yace/loader.hpp"
 #include "Yace/window.hpp"
 
 namespace priv
 {
-    std::vector<uint8_t> create_bitmap(std::array<uint8_t, 64 * 32> const& graphics, uint32_t width, uint32_t height);
-
-    std::vector<uint8_t> load_resource(std::string const& file_path);
-
-    std::map<uint8_t, ye::key> const chip8_key_layout =
-    {
-        {static_cast<uint8_t>(0x1), ye::key::one},
-        {static_cast<uint8_t>(0x2), ye::key::two},
-        {static_cast<uint8_t>(0x3), ye::key::three},
-        {static_cast<uint8_t>(0xC), ye::key::four},
-        {static_cast<uint8_t>(0x4), ye::key::q},
-        {static_cast<uint8_t>(0x5), ye::key::w},
-        {static_cast<uint8_t>(0x6), ye::key::e},
-        {static_cast<uint8_t>(0xD), ye::key::r},
-        {static_cast<uint8_t>(0x7), ye::key::a},
-        {static_cast<uint8_t>(0x8), ye::key::s},
-        {static_cast<uint8_t>(0x9), ye::key::d},
-        {static_cast<uint8_t>(0xE), ye::key::f},
-        {static_cast<uint8_t>(0xA), ye::key::z},
-        {static_cast<uint8_t>(0x0), ye::key::x},
-        {static_cast<uint8_t>(0xB), ye::key::c},
-        {static_cast<uint8_t>(0xF), ye::key::v}
-    };
+#ifndef NDEBUG
+    void GLAPIENTRY debug_callback(
+        GLenum source,
+        GLenum type,
+        GLuint id,
+        GLenum severity,
+        GLsizei length,
+        GLchar const* message,
+        void const* user_parameter);
+#endif
+
+    double const max_frame_time = 0.25; // in seconds
 }
 
 namespace ye
@@ -55,7 +48,9 @@ namespace ye
         uint32_t const width,
         uint32_t const height,
         std::string const& title,
-        uint32_t const framerate)
+        uint32_t const framerate,
+        uint32_t const clock_rate,
+        engine const engine)
     {
         try
         {
@@ -68,6 +63,7 @@ namespace ye
 
             window_.reset(new window(width, height, title));
             glfwMakeContextCurrent(&window_->get_glfw_window());
+            glfwSwapInterval(1);
 
             glewExperimental = GL_TRUE;
             if (glewInit() != GLEW_OK)
@@ -78,11 +74,25 @@ namespace ye
             if (error != GL_NO_ERROR && error != GL_INVALID_ENUM)
                 throw std::runtime_error("GLEW: Failed to handle the GL_INVALID_ENUM error after initializing GLEW.");
 
+#ifndef NDEBUG
+            // The driver reports errors as they happen instead of the render loop polling glGetError() every frame
+            if (GLEW_KHR_debug)
+            {
+                glEnable(GL_DEBUG_OUTPUT);
+                glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+                glDebugMessageCallback(priv::debug_callback, nullptr);
+            }
+#endif
+
             glViewport(0, 0, width, height);
 
             framerate_ = framerate;
+            clock_rate_ = clock_rate;
             graphics_.reset(new graphics(chip8::width, chip8::height));
             chip8_.reset(new chip8());
+            chip8_->set_engine(engine);
+            chip8_->set_clock_rate(clock_rate_);
+            frame_pacer_.reset(new frame_pacer(framerate_));
 
             YACE_LOG("OpenGL: %s, GLSL: %s\n",
                 reinterpret_cast<const char*>(glGetString(GL_VERSION)),
@@ -103,46 +113,183 @@ namespace ye
         }
     }
 
-    void application::run(std::string const& file_path, std::function<void(chip8 const& chip8)> const& update) const
+    void application::run(std::string const& file_path, std::function<void(chip8& chip8)> const& update) const
     {
         try
         {
-            chip8_->load(priv::load_resource(file_path));
-
-            while (!glfwWindowShouldClose(&window_->get_glfw_window()))
+            chip8_->load(load_resource(file_path));
+
+            triple_buffer<frame> frames;
+            std::atomic<uint32_t> pending_rows(0); // dirty rows of every frame published since the last upload
+            graphics_->set_rows(frames.get_front().data(), 0, chip8::height); // the screen is cleared by load()
+            window_->damage();
+            uint64_t presented_frames = 0;
+
+            // Shared with the emulation thread, which reads the keys straight from the keyboard
+            auto const& keyboard = window_->get_keyboard();
+            std::atomic<bool> parked(false); // waiting for a key with nothing else left to do
+            std::atomic<bool> running(true);
+            std::exception_ptr emulation_error;
+            std::mutex park_mutex;
+            std::condition_variable park_condition;
+
+            std::thread emulation_thread([&]
             {
-                const auto start_time = std::chrono::system_clock::now();
-
-                glfwPollEvents();
-
-                chip8_->emulate_cycle();
-
-                for (auto const& key : priv::chip8_key_layout)
-                    chip8_->keys[key.first] = window_->get_keyboard().is_key_pressed(key.second) ? 1 : 0;
-
-                render();
-
-                play_beep();
-
-                update(*chip8_);
-
-                glfwSwapBuffers(&window_->get_glfw_window());
-
-                if (glGetError() != GL_NO_ERROR)
-                    throw std::runtime_error("OpenGL: Failed to handle an unknown OpenGL error.");
+                try
+                {
+                    frame_pacer emulation_pacer(framerate_);
+                    const std::chrono::duration<double> update_period(1.0 / framerate_);
+                    uint16_t applied_keys = 0;
+                    auto previous_time = std::chrono::steady_clock::now();
+                    auto pending_cycles = 0.0;
+                    while (running.load(std::memory_order_relaxed))
+                    {
+                        const auto start_time = std::chrono::steady_clock::now();
+
+                        // Only changes of the keyboard are passed on, keys set by update() stay held until then
+                        const auto keys = keyboard.get_keys();
+                        if (keys != applied_keys)
+                        {
+                            applied_keys = keys;
+                            chip8_->set_keys(keys);
+                        }
+
+                        // The guest clock advances by the real time since the last batch, whatever the framerate.
+                        // Long stalls are dropped instead of being caught up in one burst.
+                        const auto elapsed_time = std::min(
+                            std::chrono::duration<double>(start_time - previous_time).count(),
+                            priv::max_frame_time);
+                        previous_time = start_time;
+                        pending_cycles += elapsed_time * clock_rate_;
+                        const auto cycles = static_cast<uint64_t>(pending_cycles);
+                        pending_cycles -= static_cast<double>(cycles);
+                        chip8_->run_cycles(cycles);
+
+                        // The rows are handed over after the frame, so the render thread never takes them before
+                        // it can pick up a frame that has them
+                        if (chip8_->redraw_flag)
+                        {
+                            chip8_->redraw_flag = false;
+                            frames.get_back() = chip8_->get_graphics();
+                            frames.publish();
+                            pending_rows.fetch_or(chip8_->dirty_rows, std::memory_order_release);
+                            chip8_->dirty_rows = 0;
+                        }
+
+                        play_beep();
+
+                        if (update)
+                            update(*chip8_);
+
+                        // Nothing happens until a key is pressed, so sleep until the key state changes instead of
+                        // running empty batches. A running sound timer, or a key update() just pressed, keeps the
+                        // batches going. update() only gets to press a key if it is called, so with one the core
+                        // wakes up once a frame to run it.
+                        if (chip8_->is_waiting_for_key() && chip8_->get_sound_timer() == 0 && chip8_->get_keys() == 0)
+                        {
+                            const auto key_changed = [&]
+                            {
+                                return keyboard.get_keys() != keys ||
+                                    !running.load(std::memory_order_relaxed);
+                            };
+                            std::unique_lock<std::mutex> lock(park_mutex);
+                            parked.store(true, std::memory_order_release);
+                            if (update)
+                                park_condition.wait_for(lock, update_period, key_changed);
+                            else
+                                park_condition.wait(lock, key_changed);
+                            parked.store(false, std::memory_order_relaxed);
+                            glfwPostEmptyEvent(); // the render thread may have gone to sleep on the parked core
+                            emulation_pacer.reset();
+                            continue;
+                        }
+
+                        emulation_pacer.wait();
+                    }
+                }
+                catch (...)
+                {
+                    emulation_error = std::current_exception();
+                    running.store(false, std::memory_order_relaxed);
+                    glfwPostEmptyEvent();
+                }
+            });
 
-                const auto end_time = std::chrono::system_clock::now();
-                const auto frame_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
-                const auto sleep_time = 1000.0 / framerate_ - frame_time;
+            const auto stop_emulation = [&]
+            {
+                {
+                    std::lock_guard<std::mutex> lock(park_mutex);
+                    running.store(false, std::memory_order_relaxed);
+                }
+                park_condition.notify_one();
+                emulation_thread.join();
+            };
 
-                if (sleep_time > 0)
+            try
+            {
+                auto notified_keys = keyboard.get_keys();
+                frame_pacer_->reset();
+                while (running.load(std::memory_order_relaxed) && !glfwWindowShouldClose(&window_->get_glfw_window()))
                 {
-                    const auto sleep_until_time = end_time + std::chrono::duration<double, std::milli>(sleep_time);
-                    while (true)
-                        if (std::chrono::system_clock::now() >= sleep_until_time)
-                            break;
+                    glfwPollEvents();
+
+                    // The key callback only ran inside glfwPollEvents(). Taking the lock once orders the change
+                    // against a core that is about to park on the old keys.
+                    const auto keys = keyboard.get_keys();
+                    if (keys != notified_keys)
+                    {
+                        notified_keys = keys;
+                        {
+                            std::lock_guard<std::mutex> lock(park_mutex);
+                        }
+                        park_condition.notify_one();
+                    }
+
+                    window_->update();
+
+                    // Only new pixels or damage to the window are presented, an unchanged screen costs no draw and no
+                    // swap. Both are checked every time so that neither is left pending for the next frame.
+                    const auto changed = upload_frame(frames, pending_rows);
+                    if (window_->was_damaged() || changed)
+                    {
+                        graphics_->render();
+                        glfwSwapBuffers(&window_->get_glfw_window());
+                        ++presented_frames;
+                    }
+
+                    // The parked core publishes its last frame before parking, once that and its rows are on screen
+                    // only input can change anything
+                    if (parked.load(std::memory_order_acquire) && !frames.is_fresh() &&
+                        pending_rows.load(std::memory_order_relaxed) == 0)
+                    {
+                        glfwWaitEvents();
+                        frame_pacer_->reset();
+                        continue;
+                    }
+
+                    frame_pacer_->wait();
                 }
             }
+            catch (...)
+            {
+                stop_emulation();
+                throw;
+            }
+
+            stop_emulation();
+            if (emulation_error)
+                std::rethrow_exception(emulation_error);
+
+            auto const& statistics = frame_pacer_->get_statistics();
+            (void)statistics;
+            (void)presented_frames;
+            YACE_LOG("Frame pacing: %llu frames, %llu presented, %llu late, overshoot %.0f us on average, "
+                "%.0f us at most.\n",
+                static_cast<unsigned long long>(statistics.frames),
+                static_cast<unsigned long long>(presented_frames),
+                static_cast<unsigned long long>(statistics.late_frames),
+                statistics.mean_overshoot,
+                statistics.max_overshoot);
         }
         catch (std::exception const& e)
         {
@@ -173,7 +320,8 @@ namespace ye
 
     application::application() :
         glfw_initialized_(false),
-        framerate_(0)
+        framerate_(0),
+        clock_rate_(0)
     {
     }
 
@@ -182,18 +330,33 @@ namespace ye
         terminate();
     }
 
-    void application::render() const
+    bool application::upload_frame(triple_buffer<frame>& frames, std::atomic<uint32_t>& pending_rows) const
     {
-        if (chip8_->redraw_flag)
+        // The rows are taken before the frame. A frame published in between is shown already, its rows come with the
+        // next call and are uploaded again from the front frame then, which has them.
+        const auto rows = pending_rows.exchange(0, std::memory_order_acquire);
+        frames.update();
+        if (rows == 0)
+            return false;
+
+        // Each run of consecutive changed rows is uploaded at once
+        auto const& latest = frames.get_front();
+        for (uint32_t y = 0; y < chip8::height;)
         {
-            chip8_->redraw_flag = false;
-            graphics_->set_bitmap(
-                priv::create_bitmap(chip8_->graphics, chip8::width, chip8::height),
-                chip8::width,
-                chip8::height);
+            if ((rows >> y & 1) == 0)
+            {
+                ++y;
+                continue;
+            }
+
+            auto end = y + 1;
+            while (end < chip8::height && (rows >> end & 1) != 0)
+                ++end;
+            graphics_->set_rows(latest.data() + y, y, end - y);
+            y = end;
         }
 
-        graphics_->render();
+        return true;
     }
 
     void application::play_beep() const
@@ -208,46 +371,22 @@ namespace ye
     }
 }
 
+#ifndef NDEBUG
 namespace priv
 {
-    std::vector<uint8_t> create_bitmap(
-        std::array<uint8_t, 64 * 32> const& graphics,
-        uint32_t const width,
-        uint32_t const height)
-    {
-        std::vector<uint8_t> bitmap(width * height * 3);
-
-        for (uint32_t y = 0; y < height; ++y)
-        {
-            for (uint32_t x = 0; x < width; ++x)
-            {
-                if (graphics[y * width + x] == 0)
-                {
-                    bitmap[y * width * 3 + x * 3 + 0] = bitmap[y * width * 3 + x * 3 + 1] = bitmap[y * width * 3 + x * 3
-                        + 2] = 0;
-                }
-                else
-                {
-                    bitmap[y * width * 3 + x * 3 + 0] = bitmap[y * width * 3 + x * 3 + 1] = bitmap[y * width * 3 + x * 3
-                        + 2] = 255;
-                }
-            }
-        }
-
-        return bitmap;
-    }
-
-    std::vector<uint8_t> load_resource(std::string const& file_path)
+    void GLAPIENTRY debug_callback(
+        GLenum,
+        const GLenum type,
+        const GLuint id,
+        const GLenum severity,
+        GLsizei,
+        GLchar const* const message,
+        void const*)
     {
-        std::ifstream file(file_path, std::ios::binary);
-        if (!file.is_open())
-            throw std::runtime_error("Application: Failed to load resource file.");
-
-        file.unsetf(std::ios::skipws);
-
-        std::vector<uint8_t> buffer;
-        buffer.insert(buffer.begin(), std::istream_iterator<uint8_t>(file), std::istream_iterator<uint8_t>());
+        if (severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+            return;
 
-        return buffer;
+        YACE_LOG("OpenGL: %s %u: %s\n", type == GL_DEBUG_TYPE_ERROR ? "Error" : "Message", id, message);
     }
 }
+#endif
@@ -1,12 +1,34 @@
 #include "Yace/chip8.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <random>
+#include <stdexcept>
+#include <utility>
+#include "Yace/compiled_rom.hpp"
+#include "Yace/random.hpp"
+#include "Yace/recompiler.hpp"
 
 namespace priv
 {
-    uint8_t generate_random_number(uint8_t min, uint8_t max);
+    uint32_t const timer_frequency = 60;
 
-    std::mt19937 mersenne_twister{std::random_device()()};
+    uint32_t const all_rows = 0xFFFFFFFF;
+
+    size_t const state_chunk_size = 64; // memory compared at a time when restoring a state
+
+    size_t const decoded_page_sweep_size = 64; // decoded pages cached before the unused ones are dropped
+
+    // A cycle count this far ahead, saturated so a budget of max() means "run until stopped"
+    uint64_t get_end(uint64_t const cycles, uint64_t const count)
+    {
+        return count > std::numeric_limits<uint64_t>::max() - cycles ?
+            std::numeric_limits<uint64_t>::max() :
+            cycles + count;
+    }
 
     std::array<uint8_t, 16 * 5> const fontset = std::array<uint8_t, 80>
     {
@@ -37,406 +59,1029 @@ namespace ye
 
     chip8::chip8() :
         redraw_flag(false),
+        dirty_rows(0),
         sound_flag(false),
-        graphics({0}),
-        keys({0}),
-        opcode_(0),
-        memory_({0}),
-        registers_({0}),
-        stack_({0}),
-        address_register_(0),
-        pc_(0),
-        delay_timer_(0),
-        sound_timer_(0),
-        stack_ptr_(0)
+        state_(),
+        decoded_pages_(),
+        written_pages_(0),
+        engine_(engine::interpreter),
+        quirks_(quirks_profile::yace),
+        tables_(&handler_tables_[static_cast<size_t>(quirks_profile::yace)]),
+        idle_loop_(),
+        idle_end_(0),
+        side_effects_(0),
+        timer_reads_(0),
+        loaded_(false)
     {
+        state_.next_event = std::numeric_limits<uint64_t>::max();
+        state_.timer_period = YACE_CLOCK_RATE / priv::timer_frequency;
+        set_keys(0);
+        seed(std::random_device()());
+        decode_pages();
     }
 
+    chip8::~chip8() = default;
+
     void chip8::load(std::vector<uint8_t> const& buffer)
     {
+        if (buffer.size() > state_.memory.size() - 0x200)
+            throw std::runtime_error("Chip8: Failed to load a program larger than the memory.");
+
         redraw_flag = true;
+        dirty_rows = priv::all_rows;
         sound_flag = false;
-        graphics.fill(0);
-        keys.fill(0);
-        opcode_ = 0;
-        memory_.fill(0);
-        registers_.fill(0);
-        address_register_ = 0;
-        pc_ = 0x200; // program memory location starts at 0x200
-        delay_timer_ = 0;
-        sound_timer_ = 0;
-        stack_.fill(0);
-        stack_ptr_ = 0;
-
-        std::copy(priv::fontset.begin(), priv::fontset.end(), memory_.begin());
-        std::copy(buffer.begin(), buffer.end(), memory_.begin() + 0x200); // program memory location starts at 0x200
+        ++side_effects_;
+
+        // Everything but the clock rate and the generator starts over
+        const auto timer_period = state_.timer_period;
+        const auto random_state = state_.random_state;
+        state_ = state();
+        state_.pc = 0x200; // program memory location starts at 0x200
+        state_.next_event = std::numeric_limits<uint64_t>::max();
+        state_.timer_period = timer_period;
+        state_.random_state = random_state;
+        set_keys(0);
+
+        state_.memory.write(0, priv::fontset.data(), priv::fontset.size());
+        state_.memory.write(0x200, buffer.data(), buffer.size()); // program memory location starts at 0x200
+
+        decode_pages();
+        if (recompiler_)
+            recompiler_->flush();
+
+        loaded_ = true;
+        if (compiled_program_)
+            compiled_program_->bind();
     }
 
     void chip8::emulate_cycle()
     {
-        // Fetch opcode
-        opcode_ = memory_[pc_] << 8 | memory_[pc_ + 1];
-
-        //YACE_LOG("\t%x\n", opcode_);
+        // A single cycle never skips ahead
+        idle_end_ = 0;
+        execute(std::numeric_limits<uint64_t>::max());
+    }
 
-        // Decode & execute opcode
-        // nnn or addr - A 12-bit value, the lowest 12 bits of the instruction
-        // n or nibble - A 4-bit value, the lowest 4 bits of the instruction
-        // x - A 4-bit value, the lower 4 bits of the high uint8_t of the instruction
-        // y - A 4-bit value, the upper 4 bits of the low uint8_t of the instruction
-        // kk or uint8_t - An 8-bit value, the lowest 8 bits of the instruction
+    void chip8::run_cycles(uint64_t const cycles)
+    {
+        const auto end = priv::get_end(state_.cycles, cycles);
+        idle_end_ = end;
+        while (state_.cycles < end)
+            execute(std::min(end, state_.next_key_release) - state_.cycles);
+    }
 
-        // 00E0 - CLS
-        // Clear the display.
-        if (opcode_ == 0x00E0)
+    stop_reason chip8::run_until(stop_condition const& condition)
+    {
+        // A breakpoint inside an idle loop has to be hit on the first iteration
+        const auto end = priv::get_end(state_.cycles, condition.cycles);
+        idle_end_ = condition.breakpoint ? 0 : end;
+        while (state_.cycles < end)
         {
-            graphics.fill(0);
-            redraw_flag = true;
-            pc_ += 2;
+            // The block engines would step over a breakpoint in the middle of a block
+            execute(condition.breakpoint ? 1 : std::min(end, state_.next_key_release) - state_.cycles);
+
+            if (condition.key_wait && state_.waiting_for_key)
+                return stop_reason::key_wait;
+            if (condition.redraw && redraw_flag)
+                return stop_reason::redraw;
+            if (condition.sound && sound_flag)
+                return stop_reason::sound;
+            if (condition.breakpoint && state_.pc == *condition.breakpoint)
+                return stop_reason::breakpoint;
         }
 
-            // 00EE - RET
-            // Return from a subroutine.
-        else if (opcode_ == 0x00EE)
+        return stop_reason::cycles;
+    }
+
+    uint64_t chip8::get_cycles() const
+    {
+        return state_.cycles;
+    }
+
+    bool chip8::is_waiting_for_key() const
+    {
+        return state_.waiting_for_key;
+    }
+
+    uint16_t chip8::get_keys() const
+    {
+        return state_.keys;
+    }
+
+    void chip8::set_keys(uint16_t const keys)
+    {
+        state_.keys = keys;
+        state_.key_releases.fill(std::numeric_limits<uint64_t>::max());
+        state_.next_key_release = std::numeric_limits<uint64_t>::max();
+    }
+
+    void chip8::tap_key(uint8_t const key, uint64_t const cycles)
+    {
+        if (key >= state_.key_releases.size())
+            throw std::runtime_error("Chip8: Failed to tap a key that is not on the keypad.");
+        if (cycles == 0)
+            return;
+
+        state_.keys |= static_cast<uint16_t>(1 << key);
+        state_.key_releases[key] = priv::get_end(state_.cycles, cycles);
+        state_.next_key_release = std::min(state_.next_key_release, state_.key_releases[key]);
+    }
+
+    uint8_t chip8::get_sound_timer() const
+    {
+        return get_timer(state_.sound_timer_end);
+    }
+
+    uint32_t chip8::get_clock_rate() const
+    {
+        return state_.timer_period * priv::timer_frequency;
+    }
+
+    void chip8::set_clock_rate(uint32_t const clock_rate)
+    {
+        // Keep the remaining timer values across the change of period
+        const auto delay_timer = get_timer(state_.delay_timer_end);
+        const auto sound_timer = get_timer(state_.sound_timer_end);
+        state_.timer_period = std::max<uint32_t>(clock_rate / priv::timer_frequency, 1);
+        state_.delay_timer_end = get_timer_tick() + delay_timer;
+        schedule_sound_timer(sound_timer);
+        ++side_effects_;
+    }
+
+    void chip8::seed(uint64_t const seed)
+    {
+        // Mixed so that neighbouring seeds don't start at neighbouring counters
+        state_.random_state = mix_random(seed);
+    }
+
+    void chip8::save_state(state& state) const
+    {
+        state = state_;
+    }
+
+    void chip8::load_state(state const& state)
+    {
+        // Only code that actually differs loses its decoded instructions and blocks, shared pages are identical
+        for (size_t page = 0; page < paged_memory::page_count; ++page)
         {
-            --stack_ptr_;
-            pc_ = stack_[stack_ptr_];
-            pc_ += 2;
+            const auto current = state_.memory.get_page(page);
+            const auto restored = state.memory.get_page(page);
+            if (current == restored)
+                continue;
+
+            for (size_t offset = 0; offset < paged_memory::page_size; offset += priv::state_chunk_size)
+                if (std::memcmp(current + offset, restored + offset, priv::state_chunk_size) != 0)
+                    invalidate(
+                        static_cast<uint16_t>(page * paged_memory::page_size + offset),
+                        static_cast<uint16_t>(priv::state_chunk_size));
         }
 
-            // 1nnn - JP addr
-            // Jump to location nnn.
-        else if ((opcode_ & 0xF000) == 0x1000)
-            pc_ = opcode_ & 0x0FFF;
+        state_ = state;
+        redraw_flag = true;
+        dirty_rows = priv::all_rows;
+        ++side_effects_;
+
+        // The pages invalidated above, or by stores since the last time, are shared again as the restored bytes decode
+        for (size_t page = 0; page < paged_memory::page_count; ++page)
+            if ((written_pages_ >> page & 1) != 0)
+                decode_page(page);
 
-            // 2nnn - CALL addr
-            // Calls subroutine at nnn.
-        else if ((opcode_ & 0xF000) == 0x2000)
+        // A core that never loaded the program picks its compiled ROM now, otherwise blocks the state restores are
+        // run compiled again
+        if (!loaded_)
         {
-            stack_[stack_ptr_] = pc_;
-            ++stack_ptr_;
-            pc_ = opcode_ & 0x0FFF;
+            loaded_ = true;
+            if (compiled_program_)
+                compiled_program_->bind();
         }
+        else if (compiled_program_)
+            compiled_program_->validate();
 
-            // 3xkk - SE Vx, uint8_t
-            // Skip next instruction if Vx = kk.
-        else if ((opcode_ & 0xF000) == 0x3000)
-            if (registers_[(opcode_ & 0x0F00) >> 8] == (opcode_ & 0x00FF))
-                pc_ += 4;
-            else
-                pc_ += 2;
+        // Pending taps come with the state and keep their release cycles, a zeroed state releases its keys right away
+        if (state_.cycles >= state_.next_key_release)
+            release_keys();
+    }
 
-            // 4xkk - SNE Vx, uint8_t
-            // Skip next instruction if Vx != kk.
-        else if ((opcode_ & 0xF000) == 0x4000)
-            if (registers_[(opcode_ & 0x0F00) >> 8] != (opcode_ & 0x00FF))
-                pc_ += 4;
-            else
-                pc_ += 2;
+    std::array<uint64_t, 32> const& chip8::get_graphics() const
+    {
+        return state_.graphics;
+    }
 
-            //  5xy0 - SE Vx, Vy
-            // Skip next instruction if Vx = Vy.
-        else if ((opcode_ & 0xF00F) == 0x5000)
-            if (registers_[(opcode_ & 0x0F00) >> 8] == registers_[(opcode_ & 0x00F0) >> 4])
-                pc_ += 4;
-            else
-                pc_ += 2;
+    uint8_t chip8::get_pixel(uint32_t const index) const
+    {
+        return static_cast<uint8_t>(state_.graphics[index / width] >> (width - 1 - index % width) & 0x1);
+    }
+
+    uint16_t chip8::get_opcode() const
+    {
+        return state_.opcode;
+    }
+
+    engine chip8::get_engine() const
+    {
+        return engine_;
+    }
+
+    void chip8::set_engine(engine const engine)
+    {
+        engine_ = engine;
+        recompiler_.reset(engine_ == engine::recompiler ? new recompiler(*this) : nullptr);
+        compiled_program_.reset(engine_ == engine::compiled ? new compiled_program(*this) : nullptr);
+    }
+
+    quirks_profile chip8::get_quirks() const
+    {
+        return quirks_;
+    }
+
+    void chip8::set_quirks(quirks_profile const quirks)
+    {
+        quirks_ = quirks;
+        tables_ = &handler_tables_[static_cast<size_t>(quirks)];
+
+        // Everything decoded so far points at the handlers of the previous profile
+        decode_pages();
+        if (recompiler_)
+            recompiler_->flush();
+        if (compiled_program_)
+            compiled_program_->bind();
+    }
 
-            // 6xkk - LD Vx, uint8_t
-            // Set Vx = kk.
-        else if ((opcode_ & 0xF000) == 0x6000)
+    // Decode
+    // nnn or addr - A 12-bit value, the lowest 12 bits of the instruction
+    // n or nibble - A 4-bit value, the lowest 4 bits of the instruction
+    // x - A 4-bit value, the lower 4 bits of the high uint8_t of the instruction
+    // y - A 4-bit value, the upper 4 bits of the low uint8_t of the instruction
+    // kk or uint8_t - An 8-bit value, the lowest 8 bits of the instruction
+
+    template <typename Quirks>
+    constexpr chip8::handler_tables chip8::create_handler_tables()
+    {
+        return
         {
-            registers_[(opcode_ & 0x0F00) >> 8] = opcode_ & 0x00FF;
-            pc_ += 2;
-        }
+            create_handlers<Quirks>(),
+            create_arithmetic_handlers<Quirks>(),
+            create_key_handlers(),
+            create_misc_handlers<Quirks>()
+        };
+    }
 
-            // 7xkk - ADD Vx, uint8_t
-            // Set Vx = Vx + kk.
-        else if ((opcode_ & 0xF000) == 0x7000)
+    template <typename Quirks>
+    constexpr chip8::handler_table<16> chip8::create_handlers()
+    {
+        return
         {
-            registers_[(opcode_ & 0x0F00) >> 8] += opcode_ & 0x00FF;
-            pc_ += 2;
-        }
+            nullptr, // 0nnn, see decode_handler
+            &chip8::jump, // 1nnn
+            &chip8::call, // 2nnn
+            &chip8::skip_if_equal_byte, // 3xkk
+            &chip8::skip_if_not_equal_byte, // 4xkk
+            &chip8::skip_if_equal_register, // 5xy0
+            &chip8::load_byte, // 6xkk
+            &chip8::add_byte, // 7xkk
+            nullptr, // 8xyN, see decode_handler
+            &chip8::skip_if_not_equal_register, // 9xy0
+            &chip8::load_address, // Annn
+            &chip8::jump_offset<Quirks>, // Bnnn
+            &chip8::random, // Cxkk
+            &chip8::draw<Quirks>, // Dxyn
+            nullptr, // ExNN, see decode_handler
+            nullptr // FxNN, see decode_handler
+        };
+    }
 
-            // 8xy0 - LD Vx, Vy
-            // Set Vx = Vy.
-        else if ((opcode_ & 0xF00F) == 0x8000)
+    template <typename Quirks>
+    constexpr chip8::handler_table<16> chip8::create_arithmetic_handlers()
+    {
+        return
         {
-            registers_[(opcode_ & 0x0F00) >> 8] = registers_[(opcode_ & 0x00F0) >> 4];
-            pc_ += 2;
-        }
+            &chip8::load_register, // 8xy0
+            &chip8::or_register<Quirks>, // 8xy1
+            &chip8::and_register<Quirks>, // 8xy2
+            &chip8::xor_register<Quirks>, // 8xy3
+            &chip8::add_register, // 8xy4
+            &chip8::sub_register, // 8xy5
+            &chip8::shift_right<Quirks>, // 8xy6
+            &chip8::subn_register, // 8xy7
+            &chip8::invalid,
+            &chip8::invalid,
+            &chip8::invalid,
+            &chip8::invalid,
+            &chip8::invalid,
+            &chip8::invalid,
+            &chip8::shift_left<Quirks>, // 8xyE
+            &chip8::invalid
+        };
+    }
 
-            // 8xy1 - OR Vx, Vy
-            // Set Vx = Vx OR Vy.
-        else if ((opcode_ & 0xF00F) == 0x8001)
+    constexpr chip8::handler_table<256> chip8::create_key_handlers()
+    {
+        handler_table<256> handlers{};
+        for (auto& handler : handlers)
+            handler = &chip8::invalid;
+
+        handlers[0x9E] = &chip8::skip_if_key_pressed;
+        handlers[0xA1] = &chip8::skip_if_key_not_pressed;
+
+        return handlers;
+    }
+
+    template <typename Quirks>
+    constexpr chip8::handler_table<256> chip8::create_misc_handlers()
+    {
+        handler_table<256> handlers{};
+        for (auto& handler : handlers)
+            handler = &chip8::invalid;
+
+        handlers[0x07] = &chip8::load_delay_timer;
+        handlers[0x0A] = &chip8::wait_key;
+        handlers[0x15] = &chip8::set_delay_timer;
+        handlers[0x18] = &chip8::set_sound_timer;
+        handlers[0x1E] = &chip8::add_address;
+        handlers[0x29] = &chip8::load_font;
+        handlers[0x33] = &chip8::store_bcd;
+        handlers[0x55] = &chip8::store_registers<Quirks>;
+        handlers[0x65] = &chip8::load_registers<Quirks>;
+
+        return handlers;
+    }
+
+    std::array<chip8::handler_tables, 3> const chip8::handler_tables_ =
+    {
+        create_handler_tables<yace_quirks>(),
+        create_handler_tables<cosmac_quirks>(),
+        create_handler_tables<superchip_quirks>()
+    };
+
+    chip8::handler chip8::decode_handler(handler_tables const& tables, uint16_t const opcode)
+    {
+        switch (opcode & 0xF000)
         {
-            registers_[(opcode_ & 0x0F00) >> 8] |= registers_[(opcode_ & 0x00F0) >> 4];
-            pc_ += 2;
+        case 0x0000:
+            if (opcode == 0x00E0)
+                return &chip8::clear_display;
+            if (opcode == 0x00EE)
+                return &chip8::return_from_subroutine;
+            return &chip8::invalid;
+        case 0x5000:
+        case 0x9000:
+            if ((opcode & 0x000F) != 0x0)
+                return &chip8::invalid;
+            break;
+        case 0x8000:
+            return tables.arithmetic_handlers[opcode & 0x000F];
+        case 0xE000:
+            return tables.key_handlers[opcode & 0x00FF];
+        case 0xF000:
+            return tables.misc_handlers[opcode & 0x00FF];
+        default:
+            break;
         }
 
-            // 8xy2 - AND Vx, Vy
-            // Set Vx = Vx AND Vy.
-        else if ((opcode_ & 0xF00F) == 0x8002)
+        return tables.handlers[opcode >> 12];
+    }
+
+    chip8::instruction chip8::decode_instruction(uint16_t const opcode) const
+    {
+        instruction instruction{};
+        instruction.execute = decode_handler(*tables_, opcode);
+        instruction.opcode = opcode;
+        instruction.nnn = opcode & 0x0FFF;
+        instruction.x = static_cast<uint8_t>((opcode & 0x0F00) >> 8);
+        instruction.y = static_cast<uint8_t>((opcode & 0x00F0) >> 4);
+        instruction.kk = static_cast<uint8_t>(opcode & 0x00FF);
+        instruction.n = static_cast<uint8_t>(opcode & 0x000F);
+
+        return instruction;
+    }
+
+    void chip8::invalidate(uint16_t address, uint16_t size)
+    {
+        // Stores through I wrap around the end of the memory, see paged_memory
+        address &= paged_memory::address_mask;
+        if (address + size > state_.memory.size())
         {
-            registers_[(opcode_ & 0x0F00) >> 8] &= registers_[(opcode_ & 0x00F0) >> 4];
-            pc_ += 2;
+            invalidate(0, static_cast<uint16_t>(address + size - state_.memory.size()));
+            size = static_cast<uint16_t>(state_.memory.size() - address);
         }
 
-            // 8xy3 - XOR Vx, Vy
-            // Set Vx = Vx XOR Vy.
-        else if ((opcode_ & 0xF00F) == 0x8003)
+        // The instruction starting one byte before the write overlaps it as well
+        const size_t first = address > 0 ? address - 1 : 0;
+        const size_t last = std::min<size_t>(address + size, state_.memory.size());
+        for (auto i = first; i < last; ++i)
+            get_writable_page(i / paged_memory::page_size).instructions[i % paged_memory::page_size].execute =
+                &chip8::decode;
+
+        if (recompiler_)
+            recompiler_->invalidate(address, size);
+
+        if (compiled_program_)
+            compiled_program_->invalidate(address, size);
+    }
+
+    void chip8::decode_pages()
+    {
+        for (size_t page = 0; page < paged_memory::page_count; ++page)
+            decode_page(page);
+    }
+
+    void chip8::decode_page(size_t const index)
+    {
+        // Everything the instructions of a page decode from: the profile, its bytes and the first byte of the next
+        // page, which the instruction at its last address reads
+        std::pair<quirks_profile, std::array<uint8_t, paged_memory::page_size + 1>> key;
+        key.first = quirks_;
+        auto const bytes = state_.memory.get_page(index);
+        std::copy(bytes, bytes + paged_memory::page_size, key.second.begin());
+        key.second.back() = state_.memory[(index + 1) * paged_memory::page_size];
+        written_pages_ &= ~(1u << index);
+
+        // Cores are loaded and restored by the workers of an env_pool at the same time
+        static std::mutex mutex;
+        static std::map<decltype(key), std::weak_ptr<decoded_page>> pages;
+        static size_t sweep_size = priv::decoded_page_sweep_size;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& cached = pages[key];
+        decoded_pages_[index] = cached.lock();
+        if (decoded_pages_[index])
+            return;
+
+        auto page = std::make_shared<decoded_page>();
+        for (size_t offset = 0; offset < paged_memory::page_size; ++offset)
+            page->instructions[offset] = decode_instruction(
+                static_cast<uint16_t>(key.second[offset] << 8 | key.second[offset + 1]));
+        cached = page;
+        decoded_pages_[index] = std::move(page);
+
+        // Pages no core holds anymore are dropped whenever the cache has doubled
+        if (pages.size() >= sweep_size)
         {
-            registers_[(opcode_ & 0x0F00) >> 8] ^= registers_[(opcode_ & 0x00F0) >> 4];
-            pc_ += 2;
+            for (auto i = pages.begin(); i != pages.end();)
+                i = i->second.expired() ? pages.erase(i) : std::next(i);
+            sweep_size = std::max(pages.size() * 2, priv::decoded_page_sweep_size);
         }
+    }
 
-            // 8xy4 - ADD Vx, Vy
-            // Set Vx = Vx + Vy, set VF = carry.
-        else if ((opcode_ & 0xF00F) == 0x8004)
+    chip8::decoded_page& chip8::get_writable_page(size_t const index)
+    {
+        // Copy on write, the shared page stays as decoded from the bytes it is cached under
+        if ((written_pages_ >> index & 1) == 0)
         {
-            if (registers_[(opcode_ & 0x0F00) >> 8] + registers_[(opcode_ & 0x00F0) >> 4] > 0xFF)
-                registers_[0xF] = 1;
-            else
-                registers_[0xF] = 0;
-            registers_[(opcode_ & 0x0F00) >> 8] += registers_[(opcode_ & 0x00F0) >> 4];
-            pc_ += 2;
+            decoded_pages_[index] = std::make_shared<decoded_page>(*decoded_pages_[index]);
+            written_pages_ |= 1u << index;
         }
 
-            // 8xy5 - SUB Vx, Vy
-            // Set Vx = Vx - Vy, set VF = NOT borrow.
-        else if ((opcode_ & 0xF00F) == 0x8005)
+        return *decoded_pages_[index];
+    }
+
+    void chip8::execute(uint64_t const budget)
+    {
+        if (recompiler_)
+            recompiler_->execute(budget);
+        else if (compiled_program_)
+            compiled_program_->execute(budget);
+        else
+            execute_instruction();
+
+        if (state_.cycles >= state_.next_event)
+            run_events();
+        if (state_.cycles >= state_.next_key_release)
+            release_keys();
+    }
+
+    void chip8::execute_instruction()
+    {
+        // An opcode at 0xFFF would end past the memory, at 0x1000 and up pc indexes past the decoded instructions
+        if (state_.pc >= 0xFFF)
+            throw std::runtime_error("Chip8: Failed to fetch opcode past the end of memory.");
+
+        // Fetch the decoded instruction, entries invalidated since they were decoded decode themselves
+        auto const& instruction =
+            decoded_pages_[state_.pc / paged_memory::page_size]->instructions[state_.pc % paged_memory::page_size];
+        state_.opcode = instruction.opcode;
+
+        //YACE_LOG("\t%x\n", state_.opcode);
+
+        // Execute opcode
+        (this->*instruction.execute)(instruction);
+        ++state_.cycles;
+    }
+
+    // The timers count down at 60 Hz of guest time. Instead of being decremented they remember the timer tick at which
+    // they reach 0, so reading them is a division and the only event left to schedule is the end of the sound.
+    uint64_t chip8::get_timer_tick() const
+    {
+        return state_.cycles / state_.timer_period;
+    }
+
+    uint8_t chip8::get_timer(uint64_t const end) const
+    {
+        const auto tick = get_timer_tick();
+
+        return static_cast<uint8_t>(end > tick ? end - tick : 0);
+    }
+
+    void chip8::schedule_sound_timer(uint8_t const value)
+    {
+        state_.sound_timer_end = get_timer_tick() + value;
+        state_.next_event = value > 0 ? state_.sound_timer_end * state_.timer_period : std::numeric_limits<uint64_t>::max();
+    }
+
+    void chip8::run_events()
+    {
+        sound_flag = true;
+        state_.next_event = std::numeric_limits<uint64_t>::max();
+    }
+
+    // Every run stops at the next release, so the instruction on the release cycle is the first one to find the key up
+    void chip8::release_keys()
+    {
+        state_.next_key_release = std::numeric_limits<uint64_t>::max();
+        for (uint8_t key = 0; key < state_.key_releases.size(); ++key)
         {
-            if (registers_[(opcode_ & 0x0F00) >> 8] > registers_[(opcode_ & 0x00F0) >> 4])
-                registers_[0xF] = 1;
-            else
-                registers_[0xF] = 0;
-            registers_[(opcode_ & 0x0F00) >> 8] -= registers_[(opcode_ & 0x00F0) >> 4];
-            pc_ += 2;
+            if (state_.key_releases[key] <= state_.cycles)
+            {
+                state_.keys &= static_cast<uint16_t>(~(1 << key));
+                state_.key_releases[key] = std::numeric_limits<uint64_t>::max();
+            }
+            state_.next_key_release = std::min(state_.next_key_release, state_.key_releases[key]);
         }
+    }
 
-            // 8xy6 - SHR Vx {, Vy}
-            // Set Vx = Vx SHR 1.
-        else if ((opcode_ & 0xF00F) == 0x8006)
+    // A backward jump that finds the registers, I, the stack and the keys exactly as its previous execution left them,
+    // with nothing but register instructions, jumps, skips and reads in between, closes a loop that will do the same
+    // over and over. Whole iterations of it are skipped by advancing the cycles, up to the end of the current run, the
+    // next event, the next key release and, while the delay timer is being read and still running, the next timer tick.
+    void chip8::skip_idle_loop()
+    {
+        auto& loop = idle_loop_;
+        const auto repeated =
+            loop.pc == state_.pc &&
+            loop.side_effects == side_effects_ &&
+            loop.registers == state_.registers &&
+            loop.address_register == state_.address_register &&
+            loop.stack_ptr == state_.stack_ptr &&
+            std::equal(loop.stack.begin(), loop.stack.begin() + loop.stack_ptr, state_.stack.begin()) &&
+            loop.keys == state_.keys;
+
+        auto end = std::min({idle_end_, state_.next_event, state_.next_key_release});
+        if (repeated && loop.timer_reads != timer_reads_)
         {
-            registers_[0xF] = registers_[(opcode_ & 0x0F00) >> 8] & 0x01;
-            registers_[(opcode_ & 0x0F00) >> 8] >>= 1;
-            pc_ += 2;
+            // Every skipped iteration has to read the delay timer values the last one read
+            const auto tick = get_timer_tick();
+            if (state_.delay_timer_end > loop.cycles / state_.timer_period)
+                end = tick == loop.cycles / state_.timer_period ? std::min(end, (tick + 1) * state_.timer_period) : 0;
         }
 
-            // 8xy7 - SUBN Vx, Vy
-            // Set Vx = Vy - Vx, set VF = NOT borrow.
-        else if ((opcode_ & 0xF00F) == 0x8007)
+        // The last skipped execution of this jump still counts as one cycle
+        const auto length = state_.cycles - loop.cycles;
+        if (repeated && end > state_.cycles + length)
+            state_.cycles += (end - 1 - state_.cycles) / length * length;
+
+        loop.pc = state_.pc;
+        loop.cycles = state_.cycles;
+        loop.side_effects = side_effects_;
+        loop.timer_reads = timer_reads_;
+        loop.registers = state_.registers;
+        loop.address_register = state_.address_register;
+        loop.stack_ptr = state_.stack_ptr;
+        loop.stack = state_.stack;
+        loop.keys = state_.keys;
+    }
+
+    // Only pages of the core's own hold entries that get here, so the page is written in place
+    void chip8::decode(instruction const&)
+    {
+        auto& instruction =
+            decoded_pages_[state_.pc / paged_memory::page_size]->instructions[state_.pc % paged_memory::page_size];
+        instruction = decode_instruction(static_cast<uint16_t>(state_.memory[state_.pc] << 8 | state_.memory[state_.pc + 1]));
+        state_.opcode = instruction.opcode;
+
+        (this->*instruction.execute)(instruction);
+    }
+
+    // 00E0 - CLS
+    // Clear the display.
+    void chip8::clear_display(instruction const&)
+    {
+        ++side_effects_;
+        state_.graphics.fill(0);
+        redraw_flag = true;
+        dirty_rows = priv::all_rows;
+        state_.pc += 2;
+    }
+
+    // 00EE - RET
+    // Return from a subroutine.
+    void chip8::return_from_subroutine(instruction const&)
+    {
+        --state_.stack_ptr;
+        state_.pc = state_.stack[state_.stack_ptr];
+        state_.pc += 2;
+    }
+
+    // 1nnn - JP addr
+    // Jump to location nnn.
+    void chip8::jump(instruction const& instruction)
+    {
+        if (instruction.nnn <= state_.pc)
+            skip_idle_loop();
+        state_.pc = instruction.nnn;
+    }
+
+    // 2nnn - CALL addr
+    // Calls subroutine at nnn.
+    void chip8::call(instruction const& instruction)
+    {
+        state_.stack[state_.stack_ptr] = state_.pc;
+        ++state_.stack_ptr;
+        state_.pc = instruction.nnn;
+    }
+
+    // 3xkk - SE Vx, uint8_t
+    // Skip next instruction if Vx = kk.
+    void chip8::skip_if_equal_byte(instruction const& instruction)
+    {
+        if (state_.registers[instruction.x] == instruction.kk)
+            state_.pc += 4;
+        else
+            state_.pc += 2;
+    }
+
+    // 4xkk - SNE Vx, uint8_t
+    // Skip next instruction if Vx != kk.
+    void chip8::skip_if_not_equal_byte(instruction const& instruction)
+    {
+        if (state_.registers[instruction.x] != instruction.kk)
+            state_.pc += 4;
+        else
+            state_.pc += 2;
+    }
+
+    //  5xy0 - SE Vx, Vy
+    // Skip next instruction if Vx = Vy.
+    void chip8::skip_if_equal_register(instruction const& instruction)
+    {
+        if (state_.registers[instruction.x] == state_.registers[instruction.y])
+            state_.pc += 4;
+        else
+            state_.pc += 2;
+    }
+
+    // 6xkk - LD Vx, uint8_t
+    // Set Vx = kk.
+    void chip8::load_byte(instruction const& instruction)
+    {
+        state_.registers[instruction.x] = instruction.kk;
+        state_.pc += 2;
+    }
+
+    // 7xkk - ADD Vx, uint8_t
+    // Set Vx = Vx + kk.
+    void chip8::add_byte(instruction const& instruction)
+    {
+        state_.registers[instruction.x] += instruction.kk;
+        state_.pc += 2;
+    }
+
+    // 8xy0 - LD Vx, Vy
+    // Set Vx = Vy.
+    void chip8::load_register(instruction const& instruction)
+    {
+        state_.registers[instruction.x] = state_.registers[instruction.y];
+        state_.pc += 2;
+    }
+
+    // 8xy1 - OR Vx, Vy
+    // Set Vx = Vx OR Vy.
+    template <typename Quirks>
+    void chip8::or_register(instruction const& instruction)
+    {
+        state_.registers[instruction.x] |= state_.registers[instruction.y];
+        if constexpr (Quirks::reset_vf)
+            state_.registers[0xF] = 0;
+        state_.pc += 2;
+    }
+
+    // 8xy2 - AND Vx, Vy
+    // Set Vx = Vx AND Vy.
+    template <typename Quirks>
+    void chip8::and_register(instruction const& instruction)
+    {
+        state_.registers[instruction.x] &= state_.registers[instruction.y];
+        if constexpr (Quirks::reset_vf)
+            state_.registers[0xF] = 0;
+        state_.pc += 2;
+    }
+
+    // 8xy3 - XOR Vx, Vy
+    // Set Vx = Vx XOR Vy.
+    template <typename Quirks>
+    void chip8::xor_register(instruction const& instruction)
+    {
+        state_.registers[instruction.x] ^= state_.registers[instruction.y];
+        if constexpr (Quirks::reset_vf)
+            state_.registers[0xF] = 0;
+        state_.pc += 2;
+    }
+
+    // 8xy4 - ADD Vx, Vy
+    // Set Vx = Vx + Vy, set VF = carry.
+    void chip8::add_register(instruction const& instruction)
+    {
+        if (state_.registers[instruction.x] + state_.registers[instruction.y] > 0xFF)
+            state_.registers[0xF] = 1;
+        else
+            state_.registers[0xF] = 0;
+        state_.registers[instruction.x] += state_.registers[instruction.y];
+        state_.pc += 2;
+    }
+
+    // 8xy5 - SUB Vx, Vy
+    // Set Vx = Vx - Vy, set VF = NOT borrow.
+    void chip8::sub_register(instruction const& instruction)
+    {
+        if (state_.registers[instruction.x] > state_.registers[instruction.y])
+            state_.registers[0xF] = 1;
+        else
+            state_.registers[0xF] = 0;
+        state_.registers[instruction.x] -= state_.registers[instruction.y];
+        state_.pc += 2;
+    }
+
+    // 8xy6 - SHR Vx {, Vy}
+    // Set Vx = Vx SHR 1, or Vx = Vy SHR 1 with the shift_vy quirk.
+    template <typename Quirks>
+    void chip8::shift_right(instruction const& instruction)
+    {
+        if constexpr (Quirks::shift_vy)
         {
-            if (registers_[(opcode_ & 0x00F0) >> 4] > registers_[(opcode_ & 0x0F00) >> 8])
-                registers_[0xF] = 1;
-            else
-                registers_[0xF] = 0;
-            registers_[(opcode_ & 0x0F00) >> 8] = registers_[(opcode_ & 0x00F0) >> 4] - registers_[(opcode_ & 0x0F00) >>
-                8];
-            pc_ += 2;
+            const auto value = state_.registers[instruction.y];
+            state_.registers[instruction.x] = value >> 1;
+            state_.registers[0xF] = value & 0x01;
         }
-
-            // 8xyE - SHL Vx {, Vy}
-            // Set Vx = Vx SHL 1.
-        else if ((opcode_ & 0xF00F) == 0x800E)
+        else
         {
-            registers_[0xF] = registers_[(opcode_ & 0x0F00) >> 8] >> 7;
-            registers_[(opcode_ & 0x0F00) >> 8] <<= 1;
-            pc_ += 2;
+            state_.registers[0xF] = state_.registers[instruction.x] & 0x01;
+            state_.registers[instruction.x] >>= 1;
         }
+        state_.pc += 2;
+    }
+
+    // 8xy7 - SUBN Vx, Vy
+    // Set Vx = Vy - Vx, set VF = NOT borrow.
+    void chip8::subn_register(instruction const& instruction)
+    {
+        if (state_.registers[instruction.y] > state_.registers[instruction.x])
+            state_.registers[0xF] = 1;
+        else
+            state_.registers[0xF] = 0;
+        state_.registers[instruction.x] = state_.registers[instruction.y] - state_.registers[instruction.x];
+        state_.pc += 2;
+    }
 
-            // 9xy0 - SNE Vx, Vy
-            // Skip next instruction if Vx != Vy.
-        else if ((opcode_ & 0xF00F) == 0x9000)
+    // 8xyE - SHL Vx {, Vy}
+    // Set Vx = Vx SHL 1, or Vx = Vy SHL 1 with the shift_vy quirk.
+    template <typename Quirks>
+    void chip8::shift_left(instruction const& instruction)
+    {
+        if constexpr (Quirks::shift_vy)
         {
-            if (registers_[(opcode_ & 0x0F00) >> 8] != registers_[(opcode_ & 0x00F0) >> 4])
-                pc_ += 4;
-            else
-                pc_ += 2;
+            const auto value = state_.registers[instruction.y];
+            state_.registers[instruction.x] = static_cast<uint8_t>(value << 1);
+            state_.registers[0xF] = value >> 7;
         }
-
-            // Annn - LD I, addr
-            // Set I = nnn.
-        else if ((opcode_ & 0xF000) == 0xA000)
+        else
         {
-            address_register_ = opcode_ & 0x0FFF;
-            pc_ += 2;
+            state_.registers[0xF] = state_.registers[instruction.x] >> 7;
+            state_.registers[instruction.x] <<= 1;
         }
+        state_.pc += 2;
+    }
 
-            // Bnnn - JP V0, addr
-            // Jump to location nnn + V0.
-        else if ((opcode_ & 0xF000) == 0xB000)
-            pc_ = (opcode_ & 0x0FFF) + registers_[0x0];
+    // 9xy0 - SNE Vx, Vy
+    // Skip next instruction if Vx != Vy.
+    void chip8::skip_if_not_equal_register(instruction const& instruction)
+    {
+        if (state_.registers[instruction.x] != state_.registers[instruction.y])
+            state_.pc += 4;
+        else
+            state_.pc += 2;
+    }
 
-            // Cxkk - RND Vx, uint8_t
-            // Set Vx = random uint8_t AND kk.
-        else if ((opcode_ & 0xF000) == 0xC000)
-        {
-            registers_[(opcode_ & 0x0F00) >> 8] = priv::generate_random_number(0x00, 0xFF) & (opcode_ & 0x00FF);
-            pc_ += 2;
-        }
+    // Annn - LD I, addr
+    // Set I = nnn.
+    void chip8::load_address(instruction const& instruction)
+    {
+        state_.address_register = instruction.nnn;
+        state_.pc += 2;
+    }
 
-            // Dxyn - DRW Vx, Vy, nibble
-            // Display n - uint8_t sprite starting at memory location I at(Vx, Vy), set VF = collision.
-        else if ((opcode_ & 0xF000) == 0xD000)
+    // Bnnn - JP V0, addr
+    // Jump to location nnn + V0, or to xnn + Vx with the jump_vx quirk.
+    template <typename Quirks>
+    void chip8::jump_offset(instruction const& instruction)
+    {
+        // nnn + V0 reaches up to 0x10FE, addresses are 12 bits
+        state_.pc = (instruction.nnn + state_.registers[Quirks::jump_vx ? instruction.x : 0x0]) & 0x0FFF;
+    }
+
+    // Cxkk - RND Vx, uint8_t
+    // Set Vx = random uint8_t AND kk.
+    void chip8::random(instruction const& instruction)
+    {
+        ++side_effects_;
+        state_.registers[instruction.x] = static_cast<uint8_t>(next_random(state_.random_state) >> 56) & instruction.kk;
+        state_.pc += 2;
+    }
+
+    // Dxyn - DRW Vx, Vy, nibble
+    // Display n - uint8_t sprite starting at memory location I at(Vx, Vy), set VF = collision.
+    template <typename Quirks>
+    void chip8::draw(instruction const& instruction)
+    {
+        ++side_effects_;
+        const uint32_t x = state_.registers[instruction.x];
+        const uint32_t y = state_.registers[instruction.y];
+        const uint32_t y_height = instruction.n;
+        state_.registers[0xF] = 0;
+        for (uint32_t y_line = 0; y_line < y_height; ++y_line)
         {
-            const uint16_t x = registers_[(opcode_ & 0x0F00) >> 8];
-            const uint16_t y = registers_[(opcode_ & 0x00F0) >> 4];
-            const uint32_t x_width = 8;
-            const uint32_t y_height = opcode_ & 0x000F;
-            registers_[0xF] = 0;
-            for (uint32_t y_line = 0; y_line < y_height; ++y_line)
+            const uint64_t pixels = state_.memory[state_.address_register + y_line];
+
+            uint32_t row;
+            uint32_t column;
+            if constexpr (Quirks::clip_sprites)
             {
-                const uint16_t pixel = memory_[address_register_ + y_line];
-                for (uint32_t x_line = 0; x_line < x_width; ++x_line)
-                    // Check if the current evaluated pixel is set to 1
-                    if ((pixel & (0x80 >> x_line)) != 0)
-                        // Prevent "array subscript out of range" error
-                        if (x + x_line + ((y + y_line) * width) < graphics.size())
-                        {
-                            // Check if the pixel on the display is set to 1
-                            if (graphics[x + x_line + ((y + y_line) * width)] == 1)
-                                registers_[0xF] = 1;
-                            graphics[x + x_line + ((y + y_line) * width)] ^= 1;
-                        }
+                // The sprite starts at (Vx, Vy) wrapped onto the screen, pixels past an edge are dropped
+                row = y % height + y_line;
+                column = x % width;
             }
-            redraw_flag = true;
-            pc_ += 2;
-        }
-
-            // Ex9E - SKP Vx
-            // Skip next instruction if key with the value of Vx is pressed.
-        else if ((opcode_ & 0xF0FF) == 0xE09E)
-            if (keys[registers_[(opcode_ & 0x0F00) >> 8]] != 0)
-                pc_ += 4;
             else
-                pc_ += 2;
-
-            // ExA1 - SKNP Vx
-            // Skip next instruction if key with the value of Vx is not pressed.
-        else if ((opcode_ & 0xF0FF) == 0xE0A1)
-            if (keys[registers_[(opcode_ & 0x0F00) >> 8]] == 0)
-                pc_ += 4;
-            else
-                pc_ += 2;
+            {
+                // Pixels past the right edge continue on the next row and pixels past the last row are dropped,
+                // exactly like the linear pixel index this display used to have
+                const auto position = (y + y_line) * width + x;
+                row = position / width;
+                column = position % width;
+            }
+            if (row >= height)
+                break;
 
-            // Fx07 - LD Vx, DT
-            // Set Vx = delay timer value.
-        else if ((opcode_ & 0xF0FF) == 0xF007)
-        {
-            registers_[(opcode_ & 0x0F00) >> 8] = delay_timer_;
-            pc_ += 2;
-        }
+            const auto sprite = pixels << (width - 8) >> column;
+            if ((state_.graphics[row] & sprite) != 0)
+                state_.registers[0xF] = 1;
+            state_.graphics[row] ^= sprite;
+            if (sprite != 0)
+                dirty_rows |= 1u << row;
 
-            // Fx0A - LD Vx, K
-            // Wait for a key press, store the value of the key in Vx.
-        else if ((opcode_ & 0xF0FF) == 0xF00A)
-        {
-            auto key_press = false;
-            for (size_t i = 0; i < keys.size(); ++i)
+            if (!Quirks::clip_sprites && column > width - 8 && row + 1 < height)
             {
-                if (keys[i] != 0)
-                {
-                    registers_[(opcode_ & 0x0F00) >> 8] = static_cast<uint8_t>(i);
-                    key_press = true;
-                }
+                const auto overflow = pixels << (2 * width - 8 - column);
+                if ((state_.graphics[row + 1] & overflow) != 0)
+                    state_.registers[0xF] = 1;
+                state_.graphics[row + 1] ^= overflow;
+                if (overflow != 0)
+                    dirty_rows |= 1u << (row + 1);
             }
-            if (!key_press)
-                return;
-            pc_ += 2;
         }
+        redraw_flag = true;
+        state_.pc += 2;
+    }
 
-            // Fx15 - LD DT, Vx
-            // Set delay timer = Vx.
-        else if ((opcode_ & 0xF0FF) == 0xF015)
-        {
-            delay_timer_ = registers_[(opcode_ & 0x0F00) >> 8];
-            pc_ += 2;
-        }
+    // Ex9E - SKP Vx
+    // Skip next instruction if key with the value of Vx is pressed.
+    void chip8::skip_if_key_pressed(instruction const& instruction)
+    {
+        const auto key = state_.registers[instruction.x];
+        if (key < 16 && (state_.keys >> key & 0x1) != 0)
+            state_.pc += 4;
+        else
+            state_.pc += 2;
+    }
 
-            // Fx18 - LD ST, Vx
-            // Set sound timer = Vx.
-        else if ((opcode_ & 0xF0FF) == 0xF018)
-        {
-            sound_timer_ = registers_[(opcode_ & 0x0F00) >> 8];
-            pc_ += 2;
-        }
+    // ExA1 - SKNP Vx
+    // Skip next instruction if key with the value of Vx is not pressed.
+    void chip8::skip_if_key_not_pressed(instruction const& instruction)
+    {
+        const auto key = state_.registers[instruction.x];
+        if (key >= 16 || (state_.keys >> key & 0x1) == 0)
+            state_.pc += 4;
+        else
+            state_.pc += 2;
+    }
 
-            // Fx1E - ADD I, Vx
-            // Set I = I + Vx.
-        else if ((opcode_ & 0xF0FF) == 0xF01E)
-        {
-            if (address_register_ + registers_[(opcode_ & 0x0F00) >> 8] > 0x0FFF)
-                registers_[0xF] = 1;
-            else
-                registers_[0xF] = 0;
-            address_register_ += registers_[(opcode_ & 0x0F00) >> 8];
-            pc_ += 2;
-        }
+    // Fx07 - LD Vx, DT
+    // Set Vx = delay timer value.
+    void chip8::load_delay_timer(instruction const& instruction)
+    {
+        ++timer_reads_;
+        state_.registers[instruction.x] = get_timer(state_.delay_timer_end);
+        state_.pc += 2;
+    }
 
-            // Fx29 - LD F, Vx
-            //Set I = location of sprite for digit Vx.
-        else if ((opcode_ & 0xF0FF) == 0xF029)
+    // Fx0A - LD Vx, K
+    // Wait for a key press, store the value of the key in Vx.
+    void chip8::wait_key(instruction const& instruction)
+    {
+        ++side_effects_;
+        const auto was_waiting = state_.waiting_for_key;
+        state_.waiting_for_key = state_.keys == 0;
+        if (state_.waiting_for_key)
         {
-            address_register_ = registers_[((opcode_ & 0x0F00) >> 8)] * 0x5;
-            pc_ += 2;
+            // Keys only change between runs, so the rest of this one is spent waiting as well. The first execution
+            // returns so that run_until() can report the wait, the next one lets the time pass up to the next event.
+            const auto end = std::min(idle_end_, state_.next_event);
+            if (was_waiting && end > state_.cycles + 1)
+                state_.cycles = end - 1;
+            return;
         }
 
-            // Fx33 - LD B, Vx
-            // Store BCD representation of Vx in memory locations I, I + 1, and I + 2.
-        else if ((opcode_ & 0xF0FF) == 0xF033)
-        {
-            memory_[address_register_] = registers_[(opcode_ & 0x0F00) >> 8] / 100;
-            memory_[address_register_ + 1] = (registers_[(opcode_ & 0x0F00) >> 8] / 10) % 10;
-            memory_[address_register_ + 2] = (registers_[(opcode_ & 0x0F00) >> 8] % 100) % 10;
-            pc_ += 2;
-        }
+        // The highest key held wins
+        uint8_t key = 15;
+        while ((state_.keys >> key & 0x1) == 0)
+            --key;
+        state_.registers[instruction.x] = key;
+        state_.pc += 2;
+    }
 
-            // Fx55 - LD [I], Vx
-            // Store registers V0 through Vx in memory starting at location I.
-        else if ((opcode_ & 0xF0FF) == 0xF055)
-        {
-            for (size_t i = 0x0; i <= ((opcode_ & 0x0F00) >> 8); ++i)
-                memory_[address_register_ + i] = registers_[i];
-            pc_ += 2;
-        }
+    // Fx15 - LD DT, Vx
+    // Set delay timer = Vx.
+    void chip8::set_delay_timer(instruction const& instruction)
+    {
+        ++side_effects_;
+        state_.delay_timer_end = get_timer_tick() + state_.registers[instruction.x];
+        state_.pc += 2;
+    }
 
-            // Fx65 - LD Vx, [I]
-            // Read registers V0 through Vx from memory starting at location I.
-        else if ((opcode_ & 0xF0FF) == 0xF065)
-        {
-            for (size_t i = 0x0; i <= ((opcode_ & 0x0F00) >> 8); ++i)
-                registers_[i] = memory_[address_register_ + i];
-            pc_ += 2;
-        }
+    // Fx18 - LD ST, Vx
+    // Set sound timer = Vx.
+    void chip8::set_sound_timer(instruction const& instruction)
+    {
+        ++side_effects_;
+        schedule_sound_timer(state_.registers[instruction.x]);
+        state_.pc += 2;
+    }
 
+    // Fx1E - ADD I, Vx
+    // Set I = I + Vx.
+    void chip8::add_address(instruction const& instruction)
+    {
+        if (state_.address_register + state_.registers[instruction.x] > 0x0FFF)
+            state_.registers[0xF] = 1;
         else
-            throw std::runtime_error("Chip8: Failed to decode opcode.");
-
-        if (delay_timer_ > 0)
-            --delay_timer_;
+            state_.registers[0xF] = 0;
+        state_.address_register += state_.registers[instruction.x];
+        state_.pc += 2;
+    }
 
-        if (sound_timer_ > 0)
-        {
-            if (sound_timer_ == 1)
-                sound_flag = true;
+    // Fx29 - LD F, Vx
+    //Set I = location of sprite for digit Vx.
+    void chip8::load_font(instruction const& instruction)
+    {
+        state_.address_register = state_.registers[instruction.x] * 0x5;
+        state_.pc += 2;
+    }
 
-            --sound_timer_;
-        }
+    // Fx33 - LD B, Vx
+    // Store BCD representation of Vx in memory locations I, I + 1, and I + 2.
+    void chip8::store_bcd(instruction const& instruction)
+    {
+        ++side_effects_;
+        state_.memory.write(state_.address_register, state_.registers[instruction.x] / 100);
+        state_.memory.write(state_.address_register + 1, (state_.registers[instruction.x] / 10) % 10);
+        state_.memory.write(state_.address_register + 2, (state_.registers[instruction.x] % 100) % 10);
+        invalidate(state_.address_register, 3);
+        state_.pc += 2;
     }
 
-    uint16_t chip8::get_opcode() const
+    // Fx55 - LD [I], Vx
+    // Store registers V0 through Vx in memory starting at location I.
+    template <typename Quirks>
+    void chip8::store_registers(instruction const& instruction)
     {
-        return opcode_;
+        ++side_effects_;
+        for (size_t i = 0x0; i <= instruction.x; ++i)
+            state_.memory.write(state_.address_register + i, state_.registers[i]);
+        invalidate(state_.address_register, instruction.x + 1);
+        if constexpr (Quirks::increment_address)
+            state_.address_register += instruction.x + 1;
+        state_.pc += 2;
     }
-}
 
-namespace priv
-{
-    uint8_t generate_random_number(uint8_t const min, uint8_t const max)
+    // Fx65 - LD Vx, [I]
+    // Read registers V0 through Vx from memory starting at location I.
+    template <typename Quirks>
+    void chip8::load_registers(instruction const& instruction)
     {
-        const std::uniform_int_distribution<uint32_t> distribution(min, max);
+        for (size_t i = 0x0; i <= instruction.x; ++i)
+            state_.registers[i] = state_.memory[state_.address_register + i];
+        if constexpr (Quirks::increment_address)
+            state_.address_register += instruction.x + 1;
+        state_.pc += 2;
+    }
 
-        return static_cast<uint8_t>(distribution(mersenne_twister));
+    void chip8::invalid(instruction const&)
+    {
+        throw std::runtime_error("Chip8: Failed to decode opcode.");
     }
 }
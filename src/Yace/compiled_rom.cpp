@@ -0,0 +1,163 @@
+#include "Yace/compiled_rom.hpp"
+
+#include <cstdio>
+#include <vector>
+#include "Yace/chip8.hpp"
+
+namespace priv
+{
+    std::vector<ye::compiled_rom const*>& get_compiled_roms();
+
+    bool is_loaded(ye::paged_memory const& memory, ye::compiled_rom const& rom);
+}
+
+namespace ye
+{
+    bool register_compiled_rom(compiled_rom const& rom)
+    {
+        priv::get_compiled_roms().push_back(&rom);
+
+        return true;
+    }
+
+    compiled_program::compiled_program(chip8& chip8) :
+        chip8_(chip8),
+        context_(),
+        rom_(nullptr),
+        blocks_({nullptr}),
+        invalidated_(false)
+    {
+        context_.registers = chip8_.state_.registers.data();
+        context_.address_register = &chip8_.state_.address_register;
+        context_.pc = &chip8_.state_.pc;
+        context_.core = &chip8_;
+        context_.step = &compiled_program::step;
+        context_.tick = &compiled_program::tick;
+
+        bind();
+    }
+
+    void compiled_program::execute(uint64_t const budget)
+    {
+        const auto block = chip8_.state_.pc < blocks_.size() ? blocks_[chip8_.state_.pc] : nullptr;
+        if (block && block->size <= budget)
+            block->execute(context_);
+        else
+            chip8_.execute_instruction();
+    }
+
+    void compiled_program::invalidate(uint16_t const address, uint16_t const size)
+    {
+        auto overlaps_code = false;
+        for (size_t i = address; i < address + size && i < code_.size(); ++i)
+            overlaps_code = overlaps_code || code_[i];
+        if (!overlaps_code)
+            return;
+
+        // Self-modified code runs through the interpreter until the next load, or a state that restores it
+        for (size_t i = 0; i < rom_->block_count; ++i)
+        {
+            auto const& block = rom_->blocks[i];
+            if (block.address < address + size && address < block.address + block.size * 2)
+            {
+                blocks_[block.address] = nullptr;
+                invalidated_ = true;
+            }
+        }
+    }
+
+    void compiled_program::bind()
+    {
+        rom_ = nullptr;
+        blocks_.fill(nullptr);
+        code_.reset();
+        invalidated_ = false;
+
+        // Nothing is loaded yet when the engine is selected before load()
+        auto const& memory = chip8_.state_.memory;
+        if (!chip8_.loaded_)
+            return;
+
+        // The blocks inline register instructions with the default behaviour
+        if (chip8_.get_quirks() != quirks_profile::yace)
+        {
+            YACE_LOG("Compiled ROM: Compiled ROMs only support the yace quirks, using the interpreter.\n");
+            return;
+        }
+
+        // Prefer the longest image in case one ROM is a prefix of another
+        for (auto const rom : priv::get_compiled_roms())
+            if (rom->image_size <= memory.size() - 0x200 &&
+                priv::is_loaded(memory, *rom) &&
+                (!rom_ || rom->image_size > rom_->image_size))
+                rom_ = rom;
+
+        if (!rom_)
+        {
+            YACE_LOG("Compiled ROM: No compiled ROM matches the loaded program, using the interpreter.\n");
+            return;
+        }
+
+        for (size_t i = 0; i < rom_->block_count; ++i)
+        {
+            auto const& block = rom_->blocks[i];
+            blocks_[block.address] = &block;
+            for (size_t j = block.address; j < block.address + block.size * 2u && j < code_.size(); ++j)
+                code_[j] = true;
+        }
+    }
+
+    void compiled_program::validate()
+    {
+        if (!rom_ || !invalidated_)
+            return;
+
+        invalidated_ = false;
+        auto const& memory = chip8_.state_.memory;
+        for (size_t i = 0; i < rom_->block_count; ++i)
+        {
+            auto const& block = rom_->blocks[i];
+            auto matches = true;
+            for (size_t j = block.address; j < block.address + block.size * 2u && matches; ++j)
+                matches = j - 0x200 < rom_->image_size && memory[j] == rom_->image[j - 0x200];
+            blocks_[block.address] = matches ? &block : nullptr;
+            invalidated_ = invalidated_ || !matches;
+        }
+    }
+
+    compiled_rom const* compiled_program::get_rom() const
+    {
+        return rom_;
+    }
+
+    void compiled_program::step(chip8& chip8)
+    {
+        chip8.execute_instruction();
+    }
+
+    void compiled_program::tick(chip8& chip8, uint32_t const cycles, uint16_t const opcode)
+    {
+        chip8.state_.cycles += cycles;
+        chip8.state_.opcode = opcode;
+    }
+}
+
+namespace priv
+{
+    std::vector<ye::compiled_rom const*>& get_compiled_roms()
+    {
+        // Compiled ROMs register themselves during static initialization, so the registry can't be a plain global
+        static std::vector<ye::compiled_rom const*> compiled_roms;
+
+        return compiled_roms;
+    }
+
+    bool is_loaded(ye::paged_memory const& memory, ye::compiled_rom const& rom)
+    {
+        for (size_t i = 0; i < rom.image_size; ++i)
+            if (memory[0x200 + i] != rom.image[i])
+                return false;
+
+        return true;
+    }
+}
@@ -0,0 +1,202 @@
+#include "Yace/env_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include "Yace/random.hpp"
+
+namespace ye
+{
+    env_pool::env_pool(
+        std::vector<uint8_t> const& program,
+        size_t const size,
+        uint64_t const cycles_per_step,
+        size_t const thread_count) :
+        size_(size),
+        cycles_per_step_(cycles_per_step),
+        cores_(new chip8[size]),
+        initial_state_(),
+        seeds_(size),
+        frames_(size),
+        chunk_count_(1),
+        job_(nullptr),
+        job_size_(0),
+        generation_(0),
+        pending_workers_(0),
+        stopping_(false)
+    {
+        if (size_ == 0)
+            throw std::runtime_error("Environment pool: Failed to create an empty pool.");
+
+        // Every core starts from the same state, so they all share the pages of the program
+        cores_[0].load(program);
+        cores_[0].save_state(initial_state_);
+        for (size_t i = 1; i < size_; ++i)
+            cores_[i].load(program);
+        seed(std::random_device()());
+        for (size_t i = 0; i < size_; ++i)
+        {
+            cores_[i].load_state(initial_state_);
+            cores_[i].seed(next_random(seeds_[i]));
+            frames_[i] = cores_[i].get_graphics();
+        }
+
+        // The calling thread works on the first chunk itself
+        const auto threads = thread_count > 0 ? thread_count : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        chunk_count_ = std::min(threads, size_);
+        for (size_t worker = 1; worker < chunk_count_; ++worker)
+            workers_.emplace_back(&env_pool::work, this, worker);
+    }
+
+    env_pool::~env_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        start_condition_.notify_all();
+
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    void env_pool::reset(std::vector<size_t> const& ids)
+    {
+        // Checked before any core is reset, so that a bad id leaves the pool as it was. A core listed twice would be
+        // reset by two workers at once.
+        std::vector<bool> listed(size_);
+        for (auto const id : ids)
+        {
+            if (id >= size_)
+                throw std::out_of_range("Environment pool: Failed to reset a core that is not in the pool.");
+            if (listed[id])
+                throw std::invalid_argument("Environment pool: Failed to reset a core listed twice.");
+            listed[id] = true;
+        }
+
+        run(ids.size(), [&](size_t const begin, size_t const end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto& core = cores_[ids[i]];
+                core.load_state(initial_state_);
+                core.seed(next_random(seeds_[ids[i]]));
+                core.set_keys(0);
+                frames_[ids[i]] = core.get_graphics();
+            }
+        });
+    }
+
+    void env_pool::seed(uint64_t const seed)
+    {
+        for (size_t i = 0; i < size_; ++i)
+            seeds_[i] = mix_random(seed + i);
+    }
+
+    void env_pool::step(std::vector<uint16_t> const& actions)
+    {
+        if (actions.size() != size_)
+            throw std::runtime_error("Environment pool: Failed to step without one action per core.");
+
+        run(size_, [&](size_t const begin, size_t const end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto& core = cores_[i];
+                core.set_keys(actions[i]);
+                core.run_cycles(cycles_per_step_);
+                frames_[i] = core.get_graphics();
+            }
+        });
+    }
+
+    std::vector<std::array<uint64_t, 32>> const& env_pool::observe() const
+    {
+        return frames_;
+    }
+
+    size_t env_pool::size() const
+    {
+        return size_;
+    }
+
+    chip8& env_pool::get_core(size_t const id)
+    {
+        if (id >= size_)
+            throw std::out_of_range("Environment pool: Failed to get a core that is not in the pool.");
+
+        return cores_[id];
+    }
+
+    void env_pool::run(size_t const count, job const& function)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &function;
+            job_size_ = count;
+            pending_workers_ = chunk_count_ - 1;
+            error_ = nullptr;
+            ++generation_;
+        }
+        start_condition_.notify_all();
+
+        std::exception_ptr error;
+        try
+        {
+            function(0, count / chunk_count_);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        // The workers still reference the job, so wait for them even if the first chunk failed
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_condition_.wait(lock, [this] { return pending_workers_ == 0; });
+        job_ = nullptr;
+
+        if (!error)
+            error = error_;
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void env_pool::work(size_t const worker)
+    {
+        uint64_t generation = 0;
+        while (true)
+        {
+            job const* function;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_condition_.wait(lock, [&] { return stopping_ || generation_ != generation; });
+                if (stopping_)
+                    return;
+
+                generation = generation_;
+                function = job_;
+                count = job_size_;
+            }
+
+            std::exception_ptr error;
+            try
+            {
+                (*function)(count * worker / chunk_count_, count * (worker + 1) / chunk_count_);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error && !error_)
+                    error_ = error;
+                --pending_workers_;
+            }
+            done_condition_.notify_one();
+        }
+    }
+}
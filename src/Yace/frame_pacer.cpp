@@ -0,0 +1,58 @@
+#include "Yace/frame_pacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace priv
+{
+    // Sleeping overshoots by up to a scheduler tick, the rest of the interval is spun
+    std::chrono::microseconds const spin_time(300);
+}
+
+namespace ye
+{
+    frame_pacer::frame_pacer(uint32_t const framerate) :
+        period_(std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(1.0 / std::max<uint32_t>(framerate, 1)))),
+        deadline_(clock::now() + period_),
+        statistics_()
+    {
+    }
+
+    void frame_pacer::wait()
+    {
+        auto now = clock::now();
+        if (now >= deadline_)
+        {
+            ++statistics_.late_frames;
+        }
+        else
+        {
+            if (deadline_ - now > priv::spin_time)
+                std::this_thread::sleep_until(deadline_ - priv::spin_time);
+            while ((now = clock::now()) < deadline_)
+                std::this_thread::yield();
+        }
+
+        const auto overshoot = std::chrono::duration<double, std::micro>(now - deadline_).count();
+        ++statistics_.frames;
+        statistics_.mean_overshoot +=
+            (overshoot - statistics_.mean_overshoot) / static_cast<double>(statistics_.frames);
+        statistics_.max_overshoot = std::max(statistics_.max_overshoot, overshoot);
+
+        // A frame that ran over by more than a whole period drops the frames it missed instead of rushing them
+        deadline_ += period_;
+        if (deadline_ < now)
+            deadline_ = now + period_;
+    }
+
+    void frame_pacer::reset()
+    {
+        deadline_ = clock::now() + period_;
+    }
+
+    frame_pacer::statistics const& frame_pacer::get_statistics() const
+    {
+        return statistics_;
+    }
+}
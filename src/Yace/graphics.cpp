@@ -1,6 +1,7 @@
 #include "Yace/graphics.hpp"
 
 #include <map>
+#include <stdexcept>
 #include "GL/glew.h"
 
 namespace priv
@@ -25,10 +26,12 @@ namespace priv
     std::string const fragment_source =
         "#version 330 core\n"
         "in vec2 vsTexCoord;"
-        "uniform sampler2D graphicsTexture;"
+        "uniform usampler2D graphicsTexture;"
+        "uniform vec4 foregroundColor;"
+        "uniform vec4 backgroundColor;"
         "out vec4 color;"
         "void main() {"
-        "color = texture(graphicsTexture, vsTexCoord);"
+        "color = texture(graphicsTexture, vsTexCoord).r != 0u ? foregroundColor : backgroundColor;"
         "}";
 
     GLfloat const texture_vertices[] =
@@ -58,7 +61,11 @@ namespace ye
         texture_id_(0),
         vertex_id_(0),
         fragment_id_(0),
-        program_id_(0)
+        program_id_(0),
+        foreground_location_(-1),
+        background_location_(-1),
+        foreground_({1.0f, 1.0f, 1.0f, 1.0f}),
+        background_({0.0f, 0.0f, 0.0f, 1.0f})
     {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -66,6 +73,7 @@ namespace ye
         create_chip8_shader(priv::vertex_source, priv::fragment_source);
         create_chip8_texture(width, height);
         create_vertex_input();
+        bind();
     }
 
     graphics::~graphics()
@@ -83,18 +91,8 @@ namespace ye
 
     void graphics::render() const
     {
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-
-        glUseProgram(program_id_);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture_id_);
-        glUniform1i(glGetUniformLocation(program_id_, "graphicsTexture"), 0);
-
-        glBindVertexArray(vao_id_);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
     }
 
     uint32_t graphics::get_height() const
@@ -107,15 +105,31 @@ namespace ye
         return width_;
     }
 
-    void graphics::set_bitmap(std::vector<uint8_t> const& bitmap, uint32_t const width, uint32_t const height)
+    // Only uploads rows [y, y + height), the colours are applied by the fragment shader
+    void graphics::set_rows(uint64_t const* const rows, uint32_t const y, uint32_t const height)
     {
-        bitmap_ = bitmap;
-        width_ = width;
-        height_ = height;
+        auto pixel = pixels_.begin() + width_ * y;
+        for (uint32_t row = 0; row < height; ++row)
+            for (uint32_t x = 0; x < width_; ++x)
+                *pixel++ = static_cast<uint8_t>(rows[row] >> (63 - x) & 0x1);
 
-        glBindTexture(GL_TEXTURE_2D, texture_id_);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGB, GL_UNSIGNED_BYTE, bitmap_.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width_, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE,
+                        pixels_.data() + width_ * y);
+    }
+
+    void graphics::set_colors(std::array<float, 4> const& foreground, std::array<float, 4> const& background)
+    {
+        if (foreground != foreground_)
+        {
+            foreground_ = foreground;
+            glUniform4fv(foreground_location_, 1, foreground_.data());
+        }
+
+        if (background != background_)
+        {
+            background_ = background;
+            glUniform4fv(background_location_, 1, background_.data());
+        }
     }
 
     void graphics::create_vertex_input()
@@ -147,19 +161,19 @@ namespace ye
     {
         width_ = width;
         height_ = height;
-        bitmap_.resize(3 * height_ * width_, 0);
+        pixels_.resize(height_ * width_, 0);
 
         glGenTextures(1, &texture_id_);
         glBindTexture(GL_TEXTURE_2D, texture_id_);
 
+        // Integer textures can't be filtered or mipmapped
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width_, height_, 0, GL_RGB, GL_UNSIGNED_BYTE, bitmap_.data());
-
-        glGenerateMipmap(GL_TEXTURE_2D);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width_, height_, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, pixels_.data());
 
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -168,6 +182,23 @@ namespace ye
     {
         priv::create_shader(vertex, fragment, vertex_id_, fragment_id_, program_id_);
     }
+
+    void graphics::bind()
+    {
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+        glUseProgram(program_id_);
+        foreground_location_ = glGetUniformLocation(program_id_, "foregroundColor");
+        background_location_ = glGetUniformLocation(program_id_, "backgroundColor");
+        glUniform1i(glGetUniformLocation(program_id_, "graphicsTexture"), 0);
+        glUniform4fv(foreground_location_, 1, foreground_.data());
+        glUniform4fv(background_location_, 1, background_.data());
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture_id_);
+
+        glBindVertexArray(vao_id_);
+    }
 }
 
 namespace priv
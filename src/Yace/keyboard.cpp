@@ -1,6 +1,6 @@
 #include "Yace/keyboard.hpp"
 
-#include <map>
+#include <array>
 #include "GLFW/glfw3.h"
 #include "Yace/window.hpp"
 
@@ -8,46 +8,30 @@ namespace priv
 {
     void key_callback(GLFWwindow* glfw_window, int glfw_key, int scancode, int action, int mods);
 
-    std::map<int, ye::key> converted_keys =
-    {
-        {GLFW_KEY_1, ye::key::one},
-        {GLFW_KEY_2, ye::key::two},
-        {GLFW_KEY_3, ye::key::three},
-        {GLFW_KEY_4, ye::key::four},
-        {GLFW_KEY_Q, ye::key::q},
-        {GLFW_KEY_W, ye::key::w},
-        {GLFW_KEY_E, ye::key::e},
-        {GLFW_KEY_R, ye::key::r},
-        {GLFW_KEY_A, ye::key::a},
-        {GLFW_KEY_S, ye::key::s},
-        {GLFW_KEY_D, ye::key::d},
-        {GLFW_KEY_F, ye::key::f},
-        {GLFW_KEY_Z, ye::key::z},
-        {GLFW_KEY_X, ye::key::x},
-        {GLFW_KEY_C, ye::key::c},
-        {GLFW_KEY_V, ye::key::v}
-    };
+    std::array<ye::key, GLFW_KEY_LAST + 1> create_converted_keys();
+
+    std::array<ye::key, GLFW_KEY_LAST + 1> const converted_keys = create_converted_keys(); // indexed by GLFW key
 
-    std::map<ye::key, char> keys_to_chars =
+    // CHIP-8 key each key is mapped to, as a bit of keyboard::get_keys(). Indexed by ye::key.
+    std::array<uint16_t, 17> const key_bits =
     {
-        {ye::key::unknown, '?'},
-        {ye::key::one, '1'},
-        {ye::key::two, '2'},
-        {ye::key::three, '3'},
-        {ye::key::four, '4'},
-        {ye::key::f, 'f'},
-        {ye::key::q, 'q'},
-        {ye::key::w, 'w'},
-        {ye::key::e, 'e'},
-        {ye::key::r, 'r'},
-        {ye::key::a, 'a'},
-        {ye::key::s, 's'},
-        {ye::key::d, 'd'},
-        {ye::key::f, 'f'},
-        {ye::key::z, 'z'},
-        {ye::key::x, 'x'},
-        {ye::key::c, 'c'},
-        {ye::key::v, 'v'}
+        0, // unknown
+        1 << 0x1, // one
+        1 << 0x2, // two
+        1 << 0x3, // three
+        1 << 0xC, // four
+        1 << 0x4, // q
+        1 << 0x5, // w
+        1 << 0x6, // e
+        1 << 0xD, // r
+        1 << 0x7, // a
+        1 << 0x8, // s
+        1 << 0x9, // d
+        1 << 0xE, // f
+        1 << 0xA, // z
+        1 << 0x0, // x
+        1 << 0xB, // c
+        1 << 0xF // v
     };
 
     ye::keyboard* keyboard = nullptr;
@@ -55,14 +39,9 @@ namespace priv
 
 namespace ye
 {
-    keyboard::keyboard(window const& window)
+    keyboard::keyboard(window const& window) :
+        key_states_(0)
     {
-        key_states_[key::unknown] =
-            key_states_[key::one] = key_states_[key::two] = key_states_[key::three] = key_states_[key::four] =
-            key_states_[key::q] = key_states_[key::w] = key_states_[key::e] = key_states_[key::r] =
-            key_states_[key::a] = key_states_[key::s] = key_states_[key::d] = key_states_[key::f] =
-            key_states_[key::z] = key_states_[key::x] = key_states_[key::c] = key_states_[key::v] = false;
-
         priv::keyboard = this;
         glfwSetKeyCallback(&window.get_glfw_window(), priv::key_callback);
     }
@@ -74,19 +53,23 @@ namespace ye
 
     void keyboard::press(key const key)
     {
-        YACE_LOG("Key %c is pressed.\n", priv::keys_to_chars[key]);
-        key_states_[key] = true;
+        key_states_.fetch_or(priv::key_bits[static_cast<size_t>(key)], std::memory_order_relaxed);
     }
 
     void keyboard::release(key const key)
     {
-        YACE_LOG("Key %c is released.\n", priv::keys_to_chars[key]);
-        key_states_[key] = false;
+        key_states_.fetch_and(static_cast<uint16_t>(~priv::key_bits[static_cast<size_t>(key)]),
+            std::memory_order_relaxed);
     }
 
     bool keyboard::is_key_pressed(key const key) const
     {
-        return key_states_.find(key)->second;
+        return (key_states_.load(std::memory_order_relaxed) & priv::key_bits[static_cast<size_t>(key)]) != 0;
+    }
+
+    uint16_t keyboard::get_keys() const
+    {
+        return key_states_.load(std::memory_order_relaxed);
     }
 }
 
@@ -94,12 +77,40 @@ namespace priv
 {
     void key_callback(GLFWwindow*, const int glfw_key, int, const int action, int)
     {
-        const auto it = converted_keys.find(glfw_key);
-        const auto key = it != converted_keys.end() ? it->second : ye::key::unknown;
+        if (glfw_key < 0 || glfw_key > GLFW_KEY_LAST)
+            return;
+        const auto key = converted_keys[glfw_key];
+        if (key == ye::key::unknown)
+            return;
 
         if (action == GLFW_PRESS)
             keyboard->press(key);
         else if (action == GLFW_RELEASE)
             keyboard->release(key);
     }
+
+    std::array<ye::key, GLFW_KEY_LAST + 1> create_converted_keys()
+    {
+        std::array<ye::key, GLFW_KEY_LAST + 1> keys;
+        keys.fill(ye::key::unknown);
+
+        keys[GLFW_KEY_1] = ye::key::one;
+        keys[GLFW_KEY_2] = ye::key::two;
+        keys[GLFW_KEY_3] = ye::key::three;
+        keys[GLFW_KEY_4] = ye::key::four;
+        keys[GLFW_KEY_Q] = ye::key::q;
+        keys[GLFW_KEY_W] = ye::key::w;
+        keys[GLFW_KEY_E] = ye::key::e;
+        keys[GLFW_KEY_R] = ye::key::r;
+        keys[GLFW_KEY_A] = ye::key::a;
+        keys[GLFW_KEY_S] = ye::key::s;
+        keys[GLFW_KEY_D] = ye::key::d;
+        keys[GLFW_KEY_F] = ye::key::f;
+        keys[GLFW_KEY_Z] = ye::key::z;
+        keys[GLFW_KEY_X] = ye::key::x;
+        keys[GLFW_KEY_C] = ye::key::c;
+        keys[GLFW_KEY_V] = ye::key::v;
+
+        return keys;
+    }
 }
@@ -0,0 +1,23 @@
+#include "Yace/loader.hpp"
+
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+
+namespace ye
+{
+    std::vector<uint8_t> load_resource(std::string const& file_path)
+    {
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Application: Failed to load resource file.");
+
+        file.unsetf(std::ios::skipws);
+
+        std::vector<uint8_t> buffer;
+        buffer.insert(buffer.begin(), std::istream_iterator<uint8_t>(file), std::istream_iterator<uint8_t>());
+
+        return buffer;
+    }
+}
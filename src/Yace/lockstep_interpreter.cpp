@@ -0,0 +1,871 @@
+#include "Yace/lockstep_interpreter.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "Yace/chip8.hpp"
+#include "Yace/random.hpp"
+
+namespace priv
+{
+    size_t const divergence_ratio = 4; // below one converged lane in this many the batch runs lane by lane
+}
+
+namespace ye
+{
+    lockstep_interpreter::lockstep_interpreter(std::vector<uint8_t> const& program, size_t const size) :
+        size_(size),
+        initial_state_(),
+        instructions_(),
+        written_(),
+        address_registers_(size),
+        pcs_(size),
+        opcodes_(size),
+        stack_ptrs_(size),
+        waiting_for_key_(size),
+        cycles_(size),
+        delay_timer_ends_(size),
+        sound_timer_ends_(size),
+        timer_periods_(size),
+        random_states_(size),
+        keys_(size),
+        stacks_(size),
+        graphics_(size),
+        memories_(size),
+        mask_(size),
+        ends_(size),
+        decoded_instructions_(0),
+        executed_instructions_(0)
+    {
+        if (size_ == 0)
+            throw std::runtime_error("Lockstep interpreter: Failed to create an empty batch.");
+
+        for (auto& registers : registers_)
+            registers.resize(size_);
+
+        // The scalar core lays out memory the way a loaded program expects it, every lane shares its pages
+        chip8 core;
+        core.load(program);
+        core.save_state(initial_state_);
+        for (size_t lane = 0; lane < size_; ++lane)
+            reset(lane);
+
+        // The last byte has no instruction of its own, is_written() keeps it from being looked up
+        for (size_t address = 0; address + 1 < instructions_.size(); ++address)
+            instructions_[address] = decode_instruction(fetch(0, static_cast<uint16_t>(address)));
+    }
+
+    void lockstep_interpreter::reset(size_t const lane)
+    {
+        load_state(lane, initial_state_);
+        keys_[lane] = 0;
+    }
+
+    void lockstep_interpreter::save_state(size_t const lane, state& state) const
+    {
+        for (size_t x = 0; x < registers_.size(); ++x)
+            state.registers[x] = registers_[x][lane];
+        state.address_register = address_registers_[lane];
+        state.pc = pcs_[lane];
+        state.opcode = opcodes_[lane];
+        state.stack_ptr = stack_ptrs_[lane];
+        state.waiting_for_key = waiting_for_key_[lane] != 0;
+        state.keys = keys_[lane];
+        state.cycles = cycles_[lane];
+        state.delay_timer_end = delay_timer_ends_[lane];
+        state.sound_timer_end = sound_timer_ends_[lane];
+        state.timer_period = timer_periods_[lane];
+        state.random_state = random_states_[lane];
+        state.stack = stacks_[lane];
+        state.graphics = graphics_[lane];
+        state.memory = memories_[lane];
+        state.key_releases.fill(std::numeric_limits<uint64_t>::max());
+        state.next_key_release = std::numeric_limits<uint64_t>::max();
+
+        // The sound timer ending is the only event, it is due unless it already went off
+        const auto sound_event = state.sound_timer_end * state.timer_period;
+        state.next_event = sound_event > state.cycles ? sound_event : std::numeric_limits<uint64_t>::max();
+    }
+
+    void lockstep_interpreter::load_state(size_t const lane, state const& state)
+    {
+        // Bytes that differ from the loaded program can't be run from the shared decoded instructions anymore
+        for (size_t page = 0; page < paged_memory::page_count; ++page)
+        {
+            const auto loaded = initial_state_.memory.get_page(page);
+            const auto restored = state.memory.get_page(page);
+            if (loaded == restored)
+                continue;
+
+            for (size_t offset = 0; offset < paged_memory::page_size; ++offset)
+                if (loaded[offset] != restored[offset])
+                    written_.set(page * paged_memory::page_size + offset);
+        }
+
+        for (size_t x = 0; x < registers_.size(); ++x)
+            registers_[x][lane] = state.registers[x];
+        address_registers_[lane] = state.address_register;
+        pcs_[lane] = state.pc;
+        opcodes_[lane] = state.opcode;
+        stack_ptrs_[lane] = state.stack_ptr;
+        waiting_for_key_[lane] = state.waiting_for_key ? 1 : 0;
+        cycles_[lane] = state.cycles;
+
+        // Lanes only hold keys through set_keys(), keys a pending tap holds are released
+        keys_[lane] = state.keys;
+        for (size_t key = 0; key < state.key_releases.size(); ++key)
+            if (state.key_releases[key] != std::numeric_limits<uint64_t>::max())
+                keys_[lane] &= static_cast<uint16_t>(~(1 << key));
+        delay_timer_ends_[lane] = state.delay_timer_end;
+        sound_timer_ends_[lane] = state.sound_timer_end;
+        timer_periods_[lane] = state.timer_period;
+        random_states_[lane] = state.random_state;
+        stacks_[lane] = state.stack;
+        graphics_[lane] = state.graphics;
+        memories_[lane] = state.memory;
+    }
+
+    void lockstep_interpreter::seed(size_t const lane, uint64_t const seed)
+    {
+        random_states_[lane] = mix_random(seed);
+    }
+
+    void lockstep_interpreter::set_keys(size_t const lane, uint16_t const keys)
+    {
+        keys_[lane] = keys;
+    }
+
+    void lockstep_interpreter::run_cycles(uint64_t const cycles)
+    {
+        decoded_instructions_ = 0;
+        executed_instructions_ = 0;
+        for (size_t lane = 0; lane < size_; ++lane)
+            ends_[lane] = cycles > std::numeric_limits<uint64_t>::max() - cycles_[lane] ?
+                std::numeric_limits<uint64_t>::max() :
+                cycles_[lane] + cycles;
+
+        for (;;)
+        {
+            // Every lane still running and at the same unmodified instruction, nothing to select
+            const auto pc = pcs_[0];
+            uint32_t diverged = 0;
+            for (size_t lane = 0; lane < size_; ++lane)
+            {
+                diverged |= static_cast<uint32_t>(pcs_[lane] != pc);
+                diverged |= static_cast<uint32_t>(cycles_[lane] >= ends_[lane]);
+            }
+            if (diverged == 0 && !is_written(pc))
+            {
+                std::fill(mask_.begin(), mask_.end(), 1);
+                step(instructions_[pc], 0, size_);
+                continue;
+            }
+
+            // Follow the lowest pc, lanes that branched ahead wait there for the others to catch up
+            size_t leader = size_;
+            size_t remaining = 0;
+            for (size_t lane = 0; lane < size_; ++lane)
+            {
+                if (cycles_[lane] >= ends_[lane])
+                    continue;
+                if (leader == size_ || pcs_[lane] < pcs_[leader])
+                    leader = lane;
+                ++remaining;
+            }
+            if (remaining == 0)
+                return;
+
+            const auto opcode = fetch(leader, pcs_[leader]);
+            if (select(pcs_[leader], opcode) * priv::divergence_ratio < remaining)
+                break;
+
+            instruction scratch;
+            step(get_instruction(leader, scratch), 0, size_);
+        }
+
+        // Too divergent to gain anything from the masks, finish lane by lane
+        for (size_t lane = 0; lane < size_; ++lane)
+        {
+            mask_[lane] = 1;
+            while (cycles_[lane] < ends_[lane])
+            {
+                instruction scratch;
+                step(get_instruction(lane, scratch), lane, lane + 1);
+            }
+        }
+    }
+
+    std::array<uint64_t, 32> const& lockstep_interpreter::get_graphics(size_t const lane) const
+    {
+        return graphics_[lane];
+    }
+
+    uint64_t lockstep_interpreter::get_cycles(size_t const lane) const
+    {
+        return cycles_[lane];
+    }
+
+    double lockstep_interpreter::get_convergence() const
+    {
+        return decoded_instructions_ > 0 ? static_cast<double>(executed_instructions_) / decoded_instructions_ : 0.0;
+    }
+
+    size_t lockstep_interpreter::size() const
+    {
+        return size_;
+    }
+
+    lockstep_interpreter::handler lockstep_interpreter::decode_handler(uint16_t const opcode)
+    {
+        switch (opcode & 0xF000)
+        {
+        case 0x0000:
+            if (opcode == 0x00E0)
+                return &lockstep_interpreter::clear_display;
+            if (opcode == 0x00EE)
+                return &lockstep_interpreter::return_from_subroutine;
+            return &lockstep_interpreter::invalid;
+        case 0x1000:
+            return &lockstep_interpreter::jump;
+        case 0x2000:
+            return &lockstep_interpreter::call;
+        case 0x3000:
+            return &lockstep_interpreter::skip_if_equal_byte;
+        case 0x4000:
+            return &lockstep_interpreter::skip_if_not_equal_byte;
+        case 0x5000:
+            if ((opcode & 0x000F) != 0x0)
+                return &lockstep_interpreter::invalid;
+            return &lockstep_interpreter::skip_if_equal_register;
+        case 0x6000:
+            return &lockstep_interpreter::load_byte;
+        case 0x7000:
+            return &lockstep_interpreter::add_byte;
+        case 0x8000:
+            switch (opcode & 0x000F)
+            {
+            case 0x0:
+                return &lockstep_interpreter::load_register;
+            case 0x1:
+                return &lockstep_interpreter::or_register;
+            case 0x2:
+                return &lockstep_interpreter::and_register;
+            case 0x3:
+                return &lockstep_interpreter::xor_register;
+            case 0x4:
+                return &lockstep_interpreter::add_register;
+            case 0x5:
+                return &lockstep_interpreter::sub_register;
+            case 0x6:
+                return &lockstep_interpreter::shift_right;
+            case 0x7:
+                return &lockstep_interpreter::subn_register;
+            case 0xE:
+                return &lockstep_interpreter::shift_left;
+            default:
+                return &lockstep_interpreter::invalid;
+            }
+        case 0x9000:
+            if ((opcode & 0x000F) != 0x0)
+                return &lockstep_interpreter::invalid;
+            return &lockstep_interpreter::skip_if_not_equal_register;
+        case 0xA000:
+            return &lockstep_interpreter::load_address;
+        case 0xB000:
+            return &lockstep_interpreter::jump_offset;
+        case 0xC000:
+            return &lockstep_interpreter::random;
+        case 0xD000:
+            return &lockstep_interpreter::draw;
+        case 0xE000:
+            if ((opcode & 0x00FF) == 0x9E)
+                return &lockstep_interpreter::skip_if_key_pressed;
+            if ((opcode & 0x00FF) == 0xA1)
+                return &lockstep_interpreter::skip_if_key_not_pressed;
+            return &lockstep_interpreter::invalid;
+        default:
+            switch (opcode & 0x00FF)
+            {
+            case 0x07:
+                return &lockstep_interpreter::load_delay_timer;
+            case 0x0A:
+                return &lockstep_interpreter::wait_key;
+            case 0x15:
+                return &lockstep_interpreter::set_delay_timer;
+            case 0x18:
+                return &lockstep_interpreter::set_sound_timer;
+            case 0x1E:
+                return &lockstep_interpreter::add_address;
+            case 0x29:
+                return &lockstep_interpreter::load_font;
+            case 0x33:
+                return &lockstep_interpreter::store_bcd;
+            case 0x55:
+                return &lockstep_interpreter::store_registers;
+            case 0x65:
+                return &lockstep_interpreter::load_registers;
+            default:
+                return &lockstep_interpreter::invalid;
+            }
+        }
+    }
+
+    lockstep_interpreter::instruction lockstep_interpreter::decode_instruction(uint16_t const opcode)
+    {
+        instruction instruction{};
+        instruction.execute = decode_handler(opcode);
+        instruction.opcode = opcode;
+        instruction.nnn = opcode & 0x0FFF;
+        instruction.x = static_cast<uint8_t>((opcode & 0x0F00) >> 8);
+        instruction.y = static_cast<uint8_t>((opcode & 0x00F0) >> 4);
+        instruction.kk = static_cast<uint8_t>(opcode & 0x00FF);
+        instruction.n = static_cast<uint8_t>(opcode & 0x000F);
+
+        return instruction;
+    }
+
+    uint16_t lockstep_interpreter::fetch(size_t const lane, uint16_t const address) const
+    {
+        auto const& memory = memories_[lane];
+
+        return static_cast<uint16_t>(memory[address] << 8 | memory[address + 1]);
+    }
+
+    lockstep_interpreter::instruction const& lockstep_interpreter::get_instruction(
+        size_t const lane,
+        instruction& scratch) const
+    {
+        const auto pc = pcs_[lane];
+        if (!is_written(pc))
+            return instructions_[pc];
+
+        // An opcode at 0xFFF would end past the memory, is_written() sends every pc from there on here
+        if (pc >= 0xFFF)
+            throw std::runtime_error("Lockstep interpreter: Failed to fetch opcode past the end of memory.");
+
+        scratch = decode_instruction(fetch(lane, pc));
+
+        return scratch;
+    }
+
+    bool lockstep_interpreter::is_written(uint16_t const address) const
+    {
+        return address + 1u >= written_.size() || written_[address] || written_[address + 1u];
+    }
+
+    void lockstep_interpreter::mark_written(size_t const address, size_t const size)
+    {
+        // Stores through I wrap around the end of the memory, see paged_memory
+        for (size_t i = 0; i < size; ++i)
+            written_.set((address + i) & paged_memory::address_mask);
+    }
+
+    size_t lockstep_interpreter::select(uint16_t const pc, uint16_t const opcode)
+    {
+        // Lanes that wrote over their code may hold another instruction at the same address
+        const auto written = is_written(pc);
+        size_t count = 0;
+        for (size_t lane = 0; lane < size_; ++lane)
+        {
+            const auto running = cycles_[lane] < ends_[lane] && pcs_[lane] == pc;
+            mask_[lane] = running && (!written || fetch(lane, pc) == opcode) ? 1 : 0;
+            count += mask_[lane];
+        }
+
+        return count;
+    }
+
+    void lockstep_interpreter::step(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        (this->*instruction.execute)(instruction, begin, end);
+
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            opcodes_[lane] = mask_[lane] ? instruction.opcode : opcodes_[lane];
+            cycles_[lane] += mask_[lane];
+            executed_instructions_ += mask_[lane];
+        }
+        ++decoded_instructions_;
+    }
+
+    void lockstep_interpreter::advance(size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * 2);
+    }
+
+    uint64_t lockstep_interpreter::get_timer_tick(size_t const lane) const
+    {
+        return cycles_[lane] / timer_periods_[lane];
+    }
+
+    // The register instructions blend their result into the unmasked lanes instead of branching around them, which
+    // lets the compiler vectorize the loops. Memory, the stack and the display are handled lane by lane.
+
+    // 00E0 - CLS
+    // Clear the display.
+    void lockstep_interpreter::clear_display(instruction const&, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+            if (mask_[lane])
+                graphics_[lane].fill(0);
+        advance(begin, end);
+    }
+
+    // 00EE - RET
+    // Return from a subroutine.
+    void lockstep_interpreter::return_from_subroutine(instruction const&, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+            --stack_ptrs_[lane];
+            pcs_[lane] = static_cast<uint16_t>(stacks_[lane][stack_ptrs_[lane]] + 2);
+        }
+    }
+
+    // 1nnn - JP addr
+    // Jump to location nnn.
+    void lockstep_interpreter::jump(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = mask_[lane] ? instruction.nnn : pcs_[lane];
+    }
+
+    // 2nnn - CALL addr
+    // Calls subroutine at nnn.
+    void lockstep_interpreter::call(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+            stacks_[lane][stack_ptrs_[lane]] = pcs_[lane];
+            ++stack_ptrs_[lane];
+            pcs_[lane] = instruction.nnn;
+        }
+    }
+
+    // 3xkk - SE Vx, uint8_t
+    // Skip next instruction if Vx = kk.
+    void lockstep_interpreter::skip_if_equal_byte(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * (vx[lane] == instruction.kk ? 4 : 2));
+    }
+
+    // 4xkk - SNE Vx, uint8_t
+    // Skip next instruction if Vx != kk.
+    void lockstep_interpreter::skip_if_not_equal_byte(
+        instruction const& instruction,
+        size_t const begin,
+        size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * (vx[lane] != instruction.kk ? 4 : 2));
+    }
+
+    //  5xy0 - SE Vx, Vy
+    // Skip next instruction if Vx = Vy.
+    void lockstep_interpreter::skip_if_equal_register(
+        instruction const& instruction,
+        size_t const begin,
+        size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * (vx[lane] == vy[lane] ? 4 : 2));
+    }
+
+    // 6xkk - LD Vx, uint8_t
+    // Set Vx = kk.
+    void lockstep_interpreter::load_byte(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            vx[lane] = mask_[lane] ? instruction.kk : vx[lane];
+        advance(begin, end);
+    }
+
+    // 7xkk - ADD Vx, uint8_t
+    // Set Vx = Vx + kk.
+    void lockstep_interpreter::add_byte(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            vx[lane] = static_cast<uint8_t>(vx[lane] + mask_[lane] * instruction.kk);
+        advance(begin, end);
+    }
+
+    // 8xy0 - LD Vx, Vy
+    // Set Vx = Vy.
+    void lockstep_interpreter::load_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        for (auto lane = begin; lane < end; ++lane)
+            vx[lane] = mask_[lane] ? vy[lane] : vx[lane];
+        advance(begin, end);
+    }
+
+    // 8xy1 - OR Vx, Vy
+    // Set Vx = Vx OR Vy.
+    void lockstep_interpreter::or_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        for (auto lane = begin; lane < end; ++lane)
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] | vy[lane]) : vx[lane];
+        advance(begin, end);
+    }
+
+    // 8xy2 - AND Vx, Vy
+    // Set Vx = Vx AND Vy.
+    void lockstep_interpreter::and_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        for (auto lane = begin; lane < end; ++lane)
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] & vy[lane]) : vx[lane];
+        advance(begin, end);
+    }
+
+    // 8xy3 - XOR Vx, Vy
+    // Set Vx = Vx XOR Vy.
+    void lockstep_interpreter::xor_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        for (auto lane = begin; lane < end; ++lane)
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] ^ vy[lane]) : vx[lane];
+        advance(begin, end);
+    }
+
+    // 8xy4 - ADD Vx, Vy
+    // Set Vx = Vx + Vy, set VF = carry.
+    void lockstep_interpreter::add_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        auto* vf = registers_[0xF].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            const uint8_t carry = vx[lane] + vy[lane] > 0xFF ? 1 : 0;
+            vf[lane] = mask_[lane] ? carry : vf[lane];
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] + vy[lane]) : vx[lane];
+        }
+        advance(begin, end);
+    }
+
+    // 8xy5 - SUB Vx, Vy
+    // Set Vx = Vx - Vy, set VF = NOT borrow.
+    void lockstep_interpreter::sub_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        auto* vf = registers_[0xF].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            const uint8_t not_borrow = vx[lane] > vy[lane] ? 1 : 0;
+            vf[lane] = mask_[lane] ? not_borrow : vf[lane];
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] - vy[lane]) : vx[lane];
+        }
+        advance(begin, end);
+    }
+
+    // 8xy6 - SHR Vx {, Vy}
+    // Set Vx = Vx SHR 1.
+    void lockstep_interpreter::shift_right(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto* vf = registers_[0xF].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            vf[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] & 0x01) : vf[lane];
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] >> 1) : vx[lane];
+        }
+        advance(begin, end);
+    }
+
+    // 8xy7 - SUBN Vx, Vy
+    // Set Vx = Vy - Vx, set VF = NOT borrow.
+    void lockstep_interpreter::subn_register(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        auto* vf = registers_[0xF].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            const uint8_t not_borrow = vy[lane] > vx[lane] ? 1 : 0;
+            vf[lane] = mask_[lane] ? not_borrow : vf[lane];
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vy[lane] - vx[lane]) : vx[lane];
+        }
+        advance(begin, end);
+    }
+
+    // 8xyE - SHL Vx {, Vy}
+    // Set Vx = Vx SHL 1.
+    void lockstep_interpreter::shift_left(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        auto* vf = registers_[0xF].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            vf[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] >> 7) : vf[lane];
+            vx[lane] = mask_[lane] ? static_cast<uint8_t>(vx[lane] << 1) : vx[lane];
+        }
+        advance(begin, end);
+    }
+
+    // 9xy0 - SNE Vx, Vy
+    // Skip next instruction if Vx != Vy.
+    void lockstep_interpreter::skip_if_not_equal_register(
+        instruction const& instruction,
+        size_t const begin,
+        size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        auto const* vy = registers_[instruction.y].data();
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * (vx[lane] != vy[lane] ? 4 : 2));
+    }
+
+    // Annn - LD I, addr
+    // Set I = nnn.
+    void lockstep_interpreter::load_address(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+            address_registers_[lane] = mask_[lane] ? instruction.nnn : address_registers_[lane];
+        advance(begin, end);
+    }
+
+    // Bnnn - JP V0, addr
+    // Jump to location nnn + V0.
+    void lockstep_interpreter::jump_offset(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* v0 = registers_[0x0].data();
+        for (auto lane = begin; lane < end; ++lane)
+            pcs_[lane] = mask_[lane] ? static_cast<uint16_t>((instruction.nnn + v0[lane]) & 0x0FFF) : pcs_[lane];
+    }
+
+    // Cxkk - RND Vx, uint8_t
+    // Set Vx = random uint8_t AND kk.
+    void lockstep_interpreter::random(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            if (mask_[lane])
+                vx[lane] = static_cast<uint8_t>(next_random(random_states_[lane]) >> 56) & instruction.kk;
+        advance(begin, end);
+    }
+
+    // Dxyn - DRW Vx, Vy, nibble
+    // Display n - uint8_t sprite starting at memory location I at(Vx, Vy), set VF = collision.
+    void lockstep_interpreter::draw(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+
+            auto& graphics = graphics_[lane];
+            auto const& memory = memories_[lane];
+            const uint32_t x = registers_[instruction.x][lane];
+            const uint32_t y = registers_[instruction.y][lane];
+            uint8_t collision = 0;
+            for (uint32_t y_line = 0; y_line < instruction.n; ++y_line)
+            {
+                const uint64_t pixels = memory[address_registers_[lane] + y_line];
+
+                // Pixels past the right edge continue on the next row, see chip8::draw()
+                const auto position = (y + y_line) * chip8::width + x;
+                const auto row = position / chip8::width;
+                const auto column = position % chip8::width;
+                if (row >= chip8::height)
+                    break;
+
+                const auto sprite = pixels << (chip8::width - 8) >> column;
+                if ((graphics[row] & sprite) != 0)
+                    collision = 1;
+                graphics[row] ^= sprite;
+
+                if (column > chip8::width - 8 && row + 1 < chip8::height)
+                {
+                    const auto overflow = pixels << (2 * chip8::width - 8 - column);
+                    if ((graphics[row + 1] & overflow) != 0)
+                        collision = 1;
+                    graphics[row + 1] ^= overflow;
+                }
+            }
+            registers_[0xF][lane] = collision;
+        }
+        advance(begin, end);
+    }
+
+    // Ex9E - SKP Vx
+    // Skip next instruction if key with the value of Vx is pressed.
+    void lockstep_interpreter::skip_if_key_pressed(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            const bool pressed = vx[lane] < 16 && (keys_[lane] >> vx[lane] & 0x1) != 0;
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * (pressed ? 4 : 2));
+        }
+    }
+
+    // ExA1 - SKNP Vx
+    // Skip next instruction if key with the value of Vx is not pressed.
+    void lockstep_interpreter::skip_if_key_not_pressed(
+        instruction const& instruction,
+        size_t const begin,
+        size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            const bool pressed = vx[lane] < 16 && (keys_[lane] >> vx[lane] & 0x1) != 0;
+            pcs_[lane] = static_cast<uint16_t>(pcs_[lane] + mask_[lane] * (pressed ? 2 : 4));
+        }
+    }
+
+    // Fx07 - LD Vx, DT
+    // Set Vx = delay timer value.
+    void lockstep_interpreter::load_delay_timer(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+            const auto tick = get_timer_tick(lane);
+            vx[lane] = static_cast<uint8_t>(delay_timer_ends_[lane] > tick ? delay_timer_ends_[lane] - tick : 0);
+        }
+        advance(begin, end);
+    }
+
+    // Fx0A - LD Vx, K
+    // Wait for a key press, store the value of the key in Vx.
+    void lockstep_interpreter::wait_key(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+
+            // The highest key held wins, like the scalar core
+            waiting_for_key_[lane] = keys_[lane] == 0 ? 1 : 0;
+            if (waiting_for_key_[lane])
+                continue;
+            uint8_t key = 15;
+            while ((keys_[lane] >> key & 0x1) == 0)
+                --key;
+            vx[lane] = key;
+            pcs_[lane] += 2;
+        }
+    }
+
+    // Fx15 - LD DT, Vx
+    // Set delay timer = Vx.
+    void lockstep_interpreter::set_delay_timer(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            if (mask_[lane])
+                delay_timer_ends_[lane] = get_timer_tick(lane) + vx[lane];
+        advance(begin, end);
+    }
+
+    // Fx18 - LD ST, Vx
+    // Set sound timer = Vx.
+    void lockstep_interpreter::set_sound_timer(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            if (mask_[lane])
+                sound_timer_ends_[lane] = get_timer_tick(lane) + vx[lane];
+        advance(begin, end);
+    }
+
+    // Fx1E - ADD I, Vx
+    // Set I = I + Vx.
+    void lockstep_interpreter::add_address(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        auto* vf = registers_[0xF].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            const uint8_t overflow = address_registers_[lane] + vx[lane] > 0x0FFF ? 1 : 0;
+            vf[lane] = mask_[lane] ? overflow : vf[lane];
+            address_registers_[lane] = static_cast<uint16_t>(address_registers_[lane] + mask_[lane] * vx[lane]);
+        }
+        advance(begin, end);
+    }
+
+    // Fx29 - LD F, Vx
+    //Set I = location of sprite for digit Vx.
+    void lockstep_interpreter::load_font(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+            address_registers_[lane] = mask_[lane] ? static_cast<uint16_t>(vx[lane] * 0x5) : address_registers_[lane];
+        advance(begin, end);
+    }
+
+    // Fx33 - LD B, Vx
+    // Store BCD representation of Vx in memory locations I, I + 1, and I + 2.
+    void lockstep_interpreter::store_bcd(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        auto const* vx = registers_[instruction.x].data();
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+            auto& memory = memories_[lane];
+            memory.write(address_registers_[lane], vx[lane] / 100);
+            memory.write(address_registers_[lane] + 1, (vx[lane] / 10) % 10);
+            memory.write(address_registers_[lane] + 2, (vx[lane] % 100) % 10);
+            mark_written(address_registers_[lane], 3);
+        }
+        advance(begin, end);
+    }
+
+    // Fx55 - LD [I], Vx
+    // Store registers V0 through Vx in memory starting at location I.
+    void lockstep_interpreter::store_registers(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+            for (size_t i = 0x0; i <= instruction.x; ++i)
+                memories_[lane].write(address_registers_[lane] + i, registers_[i][lane]);
+            mark_written(address_registers_[lane], instruction.x + 1);
+        }
+        advance(begin, end);
+    }
+
+    // Fx65 - LD Vx, [I]
+    // Read registers V0 through Vx from memory starting at location I.
+    void lockstep_interpreter::load_registers(instruction const& instruction, size_t const begin, size_t const end)
+    {
+        for (auto lane = begin; lane < end; ++lane)
+        {
+            if (!mask_[lane])
+                continue;
+            for (size_t i = 0x0; i <= instruction.x; ++i)
+                registers_[i][lane] = memories_[lane][address_registers_[lane] + i];
+        }
+        advance(begin, end);
+    }
+
+    void lockstep_interpreter::invalid(instruction const&, size_t, size_t)
+    {
+        throw std::runtime_error("Lockstep interpreter: Failed to decode opcode.");
+    }
+}
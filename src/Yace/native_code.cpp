@@ -0,0 +1,694 @@
+#include "Yace/native_code.hpp"
+
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "Yace/state.hpp"
+
+#ifdef YACE_NATIVE_CODE
+#   ifdef _WIN32
+#       define WIN32_LEAN_AND_MEAN
+#       define NOMINMAX
+#       include <windows.h>
+#   else
+#       include <sys/mman.h>
+#   endif
+#endif
+
+#ifdef YACE_NATIVE_CODE
+namespace priv
+{
+    size_t const code_size = 256 * 1024; // a few KB per program in practice
+
+    // Host registers by encoding
+    enum : int
+    {
+        eax = 0,
+        ecx = 1,
+        edx = 2,
+        ebx = 3,
+        ebp = 5,
+        esi = 6,
+        edi = 7, // holds the state pointer
+        r8 = 8,
+        r9 = 9,
+        r10 = 10,
+        r11 = 11,
+        r12 = 12,
+        r13 = 13,
+        r14 = 14,
+        r15 = 15
+    };
+
+    // Registers the V registers of a run are kept in, the scratch registers eax, ecx and edx are left out
+    std::array<int, 11> const host_registers = {esi, r8, r9, r10, r11, ebx, ebp, r12, r13, r14, r15};
+
+#ifdef _WIN32
+    bool const callee_saved[16] = {false, false, false, true, false, true, true, true,
+                                   false, false, false, false, true, true, true, true};
+#else
+    bool const callee_saved[16] = {false, false, false, true, false, true, false, false,
+                                   false, false, false, false, true, true, true, true};
+#endif
+
+    // Condition codes
+    uint8_t const equal = 0x4;
+    uint8_t const not_equal = 0x5;
+    uint8_t const above = 0x7;
+
+    // ALU operations, as the opcode of "op r/m32, r32" and the digit of "op r/m32, imm32"
+    uint8_t const add = 0x01;
+    uint8_t const or_ = 0x09;
+    uint8_t const and_ = 0x21;
+    uint8_t const sub = 0x29;
+    uint8_t const xor_ = 0x31;
+    uint8_t const cmp = 0x39;
+    uint8_t const mov = 0x89;
+
+    int const add_digit = 0;
+    int const and_digit = 4;
+    int const cmp_digit = 7;
+
+    int const shl_digit = 4;
+    int const shr_digit = 5;
+
+    // Offsets of the fields a run touches, from the start of ye::state
+    struct layout
+    {
+        int32_t registers;
+
+        int32_t address_register;
+
+        int32_t pc;
+
+        int32_t opcode;
+
+        int32_t cycles;
+    };
+
+    layout const& get_layout();
+
+    // Emits the few x86-64 instructions the runs are made of. Operands are 32-bit registers or [rdi + disp32].
+    class assembler
+    {
+    public:
+        std::vector<uint8_t> const& get_code() const
+        {
+            return code_;
+        }
+
+        // op dst, src
+        void alu(uint8_t const operation, int const dst, int const src)
+        {
+            rex(false, src, dst);
+            code_.push_back(operation);
+            modrm_register(src, dst);
+        }
+
+        // op dst, imm32
+        void alu(int const digit, int const dst, uint32_t const value)
+        {
+            rex(false, 0, dst);
+            code_.push_back(0x81);
+            modrm_register(digit, dst);
+            dword(value);
+        }
+
+        void mov(int const dst, uint32_t const value)
+        {
+            rex(false, 0, dst);
+            code_.push_back(static_cast<uint8_t>(0xB8 + (dst & 0x7)));
+            dword(value);
+        }
+
+        void shift(int const digit, int const dst, uint8_t const count)
+        {
+            rex(false, 0, dst);
+            code_.push_back(0xC1);
+            modrm_register(digit, dst);
+            code_.push_back(count);
+        }
+
+        // setcc dst8, only used with the scratch registers whose low byte needs no REX prefix
+        void set(uint8_t const condition, int const dst)
+        {
+            code_.push_back(0x0F);
+            code_.push_back(static_cast<uint8_t>(0x90 | condition));
+            modrm_register(0, dst);
+        }
+
+        void cmov(uint8_t const condition, int const dst, int const src)
+        {
+            rex(false, dst, src);
+            code_.push_back(0x0F);
+            code_.push_back(static_cast<uint8_t>(0x40 | condition));
+            modrm_register(dst, src);
+        }
+
+        // movzx dst, byte [rdi + offset]
+        void load_byte(int const dst, int32_t const offset)
+        {
+            rex(false, dst, edi);
+            code_.push_back(0x0F);
+            code_.push_back(0xB6);
+            modrm_memory(dst, offset);
+        }
+
+        // mov byte [rdi + offset], src8, the REX prefix selects sil/bpl instead of dh/ch
+        void store_byte(int const src, int32_t const offset)
+        {
+            rex(false, src, edi, true);
+            code_.push_back(0x88);
+            modrm_memory(src, offset);
+        }
+
+        // movzx dst, word [rdi + offset]
+        void load_word(int const dst, int32_t const offset)
+        {
+            rex(false, dst, edi);
+            code_.push_back(0x0F);
+            code_.push_back(0xB7);
+            modrm_memory(dst, offset);
+        }
+
+        // mov word [rdi + offset], src16
+        void store_word(int const src, int32_t const offset)
+        {
+            code_.push_back(0x66);
+            rex(false, src, edi);
+            code_.push_back(0x89);
+            modrm_memory(src, offset);
+        }
+
+        // mov word [rdi + offset], imm16
+        void store_word(int32_t const offset, uint16_t const value)
+        {
+            code_.push_back(0x66);
+            code_.push_back(0xC7);
+            modrm_memory(0, offset);
+            code_.push_back(static_cast<uint8_t>(value));
+            code_.push_back(static_cast<uint8_t>(value >> 8));
+        }
+
+        // add qword [rdi + offset], imm32
+        void add_qword(int32_t const offset, uint32_t const value)
+        {
+            rex(true, 0, edi);
+            code_.push_back(0x81);
+            modrm_memory(add_digit, offset);
+            dword(value);
+        }
+
+        void push(int const reg)
+        {
+            if (reg >= 8)
+                code_.push_back(0x41);
+            code_.push_back(static_cast<uint8_t>(0x50 + (reg & 0x7)));
+        }
+
+        void pop(int const reg)
+        {
+            if (reg >= 8)
+                code_.push_back(0x41);
+            code_.push_back(static_cast<uint8_t>(0x58 + (reg & 0x7)));
+        }
+
+        // mov rdi, rcx
+        void move_argument()
+        {
+            code_.push_back(0x48);
+            code_.push_back(0x89);
+            code_.push_back(0xCF);
+        }
+
+        void ret()
+        {
+            code_.push_back(0xC3);
+        }
+
+    private:
+        void rex(bool const wide, int const reg, int const rm, bool const force = false)
+        {
+            const auto prefix = static_cast<uint8_t>(
+                0x40 | (wide ? 0x8 : 0x0) | (reg >> 3 & 0x1) << 2 | (rm >> 3 & 0x1));
+            if (prefix != 0x40 || force)
+                code_.push_back(prefix);
+        }
+
+        void modrm_register(int const reg, int const rm)
+        {
+            code_.push_back(static_cast<uint8_t>(0xC0 | (reg & 0x7) << 3 | (rm & 0x7)));
+        }
+
+        void modrm_memory(int const reg, int32_t const offset)
+        {
+            code_.push_back(static_cast<uint8_t>(0x80 | (reg & 0x7) << 3 | edi));
+            dword(static_cast<uint32_t>(offset));
+        }
+
+        void dword(uint32_t const value)
+        {
+            for (auto i = 0; i < 4; ++i)
+                code_.push_back(static_cast<uint8_t>(value >> i * 8));
+        }
+
+        std::vector<uint8_t> code_;
+    };
+
+    struct quirk_flags
+    {
+        bool shift_vy;
+
+        bool reset_vf;
+    };
+
+    template <typename Quirks>
+    constexpr quirk_flags get_quirk_flags()
+    {
+        return {Quirks::shift_vy, Quirks::reset_vf};
+    }
+
+    quirk_flags get_quirk_flags(ye::quirks_profile quirks);
+
+    bool is_skip(uint16_t opcode);
+
+    // Bit v is set for every V register the instruction reads or writes, and in written for the ones it writes
+    uint16_t get_used_registers(uint16_t opcode, quirk_flags const& quirks, uint16_t& written);
+
+    void emit_instruction(assembler& assembler, uint16_t address, uint16_t opcode, quirk_flags const& quirks,
+                          std::array<int, 16> const& hosts);
+}
+#endif
+
+namespace ye
+{
+    native_code::native_code() :
+        memory_(nullptr),
+        size_(0),
+        used_(0)
+    {
+#ifdef YACE_NATIVE_CODE
+#   ifdef _WIN32
+        auto* const memory = VirtualAlloc(nullptr, priv::code_size, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READ);
+        if (!memory)
+            throw std::runtime_error("Native code: Failed to allocate executable memory.");
+#   else
+        auto* const memory = mmap(nullptr, priv::code_size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::runtime_error("Native code: Failed to allocate executable memory.");
+#   endif
+        memory_ = static_cast<uint8_t*>(memory);
+        size_ = priv::code_size;
+#endif
+    }
+
+    native_code::~native_code()
+    {
+#ifdef YACE_NATIVE_CODE
+#   ifdef _WIN32
+        VirtualFree(memory_, 0, MEM_RELEASE);
+#   else
+        munmap(memory_, size_);
+#   endif
+#endif
+    }
+
+    bool native_code::is_available()
+    {
+#ifdef YACE_NATIVE_CODE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool native_code::is_supported(uint16_t const opcode)
+    {
+        switch (opcode & 0xF000)
+        {
+        case 0x3000:
+        case 0x4000:
+        case 0x6000:
+        case 0x7000:
+        case 0xA000:
+            return true;
+        case 0x5000:
+        case 0x9000:
+            return (opcode & 0x000F) == 0x0;
+        case 0x8000:
+            return (opcode & 0x000F) <= 0x7 || (opcode & 0x000F) == 0xE;
+        case 0xF000:
+            return (opcode & 0x00FF) == 0x1E;
+        default:
+            return false;
+        }
+    }
+
+    native_code::function native_code::compile(
+        uint16_t const address,
+        uint16_t const* const opcodes,
+        size_t& count,
+        quirks_profile const quirks)
+    {
+#ifdef YACE_NATIVE_CODE
+        const auto flags = priv::get_quirk_flags(quirks);
+        auto const& layout = priv::get_layout();
+
+        // Take opcodes as long as their V registers fit in the host registers
+        uint16_t used = 0;
+        uint16_t written = 0;
+        size_t compiled = 0;
+        while (compiled < count)
+        {
+            uint16_t instruction_written = 0;
+            const auto instruction_used = priv::get_used_registers(opcodes[compiled], flags, instruction_written);
+            std::bitset<16> const registers(used | instruction_used);
+            if (registers.count() > priv::host_registers.size())
+                break;
+
+            used |= instruction_used;
+            written |= instruction_written;
+            if (priv::is_skip(opcodes[compiled++]))
+                break;
+        }
+        count = compiled;
+        if (compiled == 0)
+            return nullptr;
+
+        std::array<int, 16> hosts{};
+        std::vector<int> saved;
+        size_t next_host = 0;
+        for (size_t v = 0; v < hosts.size(); ++v)
+            if ((used >> v & 0x1) != 0)
+            {
+                hosts[v] = priv::host_registers[next_host++];
+                if (priv::callee_saved[hosts[v]])
+                    saved.push_back(hosts[v]);
+            }
+
+        priv::assembler assembler;
+#   ifdef _WIN32
+        assembler.push(priv::edi);
+        assembler.move_argument();
+#   endif
+        for (auto const reg : saved)
+            assembler.push(reg);
+        for (size_t v = 0; v < hosts.size(); ++v)
+            if ((used >> v & 0x1) != 0)
+                assembler.load_byte(hosts[v], layout.registers + static_cast<int32_t>(v));
+
+        for (size_t i = 0; i < compiled; ++i)
+            priv::emit_instruction(assembler, static_cast<uint16_t>(address + i * 2), opcodes[i], flags, hosts);
+
+        // pc, the skip leaves it in eax
+        const auto last = opcodes[compiled - 1];
+        const auto last_address = static_cast<uint16_t>(address + (compiled - 1) * 2);
+        if (priv::is_skip(last))
+            assembler.store_word(priv::eax, layout.pc);
+        else
+            assembler.store_word(layout.pc, static_cast<uint16_t>(last_address + 2));
+        assembler.store_word(layout.opcode, last);
+        assembler.add_qword(layout.cycles, static_cast<uint32_t>(compiled));
+
+        for (size_t v = 0; v < hosts.size(); ++v)
+            if ((written >> v & 0x1) != 0)
+                assembler.store_byte(hosts[v], layout.registers + static_cast<int32_t>(v));
+        for (auto it = saved.rbegin(); it != saved.rend(); ++it)
+            assembler.pop(*it);
+#   ifdef _WIN32
+        assembler.pop(priv::edi);
+#   endif
+        assembler.ret();
+
+        auto const& code = assembler.get_code();
+        if (used_ + code.size() > size_)
+        {
+            count = 0;
+            return nullptr;
+        }
+
+        // The memory is only writable while a function is copied into it
+        auto* const function_memory = memory_ + used_;
+#   ifdef _WIN32
+        DWORD protection;
+        VirtualProtect(memory_, size_, PAGE_READWRITE, &protection);
+        std::memcpy(function_memory, code.data(), code.size());
+        VirtualProtect(memory_, size_, PAGE_EXECUTE_READ, &protection);
+        FlushInstructionCache(GetCurrentProcess(), function_memory, code.size());
+#   else
+        if (mprotect(memory_, size_, PROT_READ | PROT_WRITE) != 0)
+            throw std::runtime_error("Native code: Failed to make the code memory writable.");
+        std::memcpy(function_memory, code.data(), code.size());
+        if (mprotect(memory_, size_, PROT_READ | PROT_EXEC) != 0)
+            throw std::runtime_error("Native code: Failed to make the code memory executable.");
+#   endif
+        used_ += code.size();
+
+        return reinterpret_cast<function>(function_memory);
+#else
+        (void)address;
+        (void)opcodes;
+        (void)quirks;
+        count = 0;
+
+        return nullptr;
+#endif
+    }
+
+    void native_code::clear()
+    {
+        used_ = 0;
+    }
+}
+
+#ifdef YACE_NATIVE_CODE
+namespace priv
+{
+    layout const& get_layout()
+    {
+        static auto const offsets = []
+        {
+            const ye::state state{};
+            const auto offset = [&state](void const* field)
+            {
+                return static_cast<int32_t>(static_cast<char const*>(field) - reinterpret_cast<char const*>(&state));
+            };
+
+            return priv::layout
+            {
+                offset(state.registers.data()),
+                offset(&state.address_register),
+                offset(&state.pc),
+                offset(&state.opcode),
+                offset(&state.cycles)
+            };
+        }();
+
+        return offsets;
+    }
+
+    quirk_flags get_quirk_flags(ye::quirks_profile const quirks)
+    {
+        switch (quirks)
+        {
+        case ye::quirks_profile::cosmac:
+            return get_quirk_flags<ye::cosmac_quirks>();
+        case ye::quirks_profile::superchip:
+            return get_quirk_flags<ye::superchip_quirks>();
+        default:
+            return get_quirk_flags<ye::yace_quirks>();
+        }
+    }
+
+    bool is_skip(uint16_t const opcode)
+    {
+        const auto group = opcode & 0xF000;
+
+        return group == 0x3000 || group == 0x4000 || group == 0x5000 || group == 0x9000;
+    }
+
+    uint16_t get_used_registers(uint16_t const opcode, quirk_flags const& quirks, uint16_t& written)
+    {
+        const auto x = static_cast<uint16_t>(1 << (opcode >> 8 & 0xF));
+        const auto y = static_cast<uint16_t>(1 << (opcode >> 4 & 0xF));
+        const uint16_t vf = 0x8000;
+
+        written = 0;
+        switch (opcode & 0xF000)
+        {
+        case 0x3000:
+        case 0x4000:
+            return x;
+        case 0x5000:
+        case 0x9000:
+            return x | y;
+        case 0x6000:
+        case 0x7000:
+            written = x;
+            return x;
+        case 0x8000:
+            switch (opcode & 0x000F)
+            {
+            case 0x0:
+                written = x;
+                return x | y;
+            case 0x1:
+            case 0x2:
+            case 0x3:
+                written = quirks.reset_vf ? x | vf : x;
+                return x | y | (quirks.reset_vf ? vf : 0);
+            case 0x6:
+            case 0xE:
+                written = x | vf;
+                return x | vf | (quirks.shift_vy ? y : 0);
+            default: // 8xy4, 8xy5, 8xy7
+                written = x | vf;
+                return x | y | vf;
+            }
+        case 0xF000: // Fx1E
+            written = vf;
+            return x | vf;
+        default: // Annn
+            return 0;
+        }
+    }
+
+    // Mirrors the instruction handlers of ye::chip8 statement by statement, so that VF as an operand sees the same
+    // values. Host registers hold the V registers zero-extended, results are masked back to 8 bits.
+    void emit_instruction(
+        assembler& assembler,
+        uint16_t const address,
+        uint16_t const opcode,
+        quirk_flags const& quirks,
+        std::array<int, 16> const& hosts)
+    {
+        const auto vx = hosts[opcode >> 8 & 0xF];
+        const auto vy = hosts[opcode >> 4 & 0xF];
+        const auto vf = hosts[0xF];
+        const uint8_t kk = opcode & 0xFF;
+        auto const& layout = get_layout();
+
+        switch (opcode & 0xF000)
+        {
+        case 0x3000: // SE Vx, kk, pc is left in eax
+        case 0x4000: // SNE Vx, kk
+        case 0x5000: // SE Vx, Vy
+        case 0x9000: // SNE Vx, Vy
+        {
+            assembler.mov(eax, static_cast<uint32_t>(address + 2));
+            assembler.mov(edx, static_cast<uint32_t>(address + 4));
+            if ((opcode & 0xF000) == 0x3000 || (opcode & 0xF000) == 0x4000)
+                assembler.alu(cmp_digit, vx, static_cast<uint32_t>(kk));
+            else
+                assembler.alu(cmp, vx, vy);
+            const auto equal_skips = (opcode & 0xF000) == 0x3000 || (opcode & 0xF000) == 0x5000;
+            assembler.cmov(equal_skips ? equal : not_equal, eax, edx);
+            break;
+        }
+        case 0x6000: // LD Vx, kk
+            assembler.mov(vx, kk);
+            break;
+        case 0x7000: // ADD Vx, kk
+            assembler.alu(add_digit, vx, static_cast<uint32_t>(kk));
+            assembler.alu(and_digit, vx, 0xFFu);
+            break;
+        case 0x8000:
+            switch (opcode & 0x000F)
+            {
+            case 0x0: // LD Vx, Vy
+                assembler.alu(mov, vx, vy);
+                break;
+            case 0x1: // OR Vx, Vy
+            case 0x2: // AND Vx, Vy
+            case 0x3: // XOR Vx, Vy
+            {
+                const auto operation = (opcode & 0x000F) == 0x1 ? or_ : (opcode & 0x000F) == 0x2 ? and_ : xor_;
+                assembler.alu(operation, vx, vy);
+                if (quirks.reset_vf)
+                    assembler.mov(vf, 0u);
+                break;
+            }
+            case 0x4: // ADD Vx, Vy, VF = carry
+                assembler.alu(mov, eax, vx);
+                assembler.alu(add, eax, vy);
+                assembler.shift(shr_digit, eax, 8);
+                assembler.alu(mov, vf, eax);
+                assembler.alu(add, vx, vy);
+                assembler.alu(and_digit, vx, 0xFFu);
+                break;
+            case 0x5: // SUB Vx, Vy, VF = NOT borrow
+                assembler.alu(xor_, edx, edx);
+                assembler.alu(cmp, vx, vy);
+                assembler.set(above, edx);
+                assembler.alu(mov, vf, edx);
+                assembler.alu(sub, vx, vy);
+                assembler.alu(and_digit, vx, 0xFFu);
+                break;
+            case 0x6: // SHR Vx {, Vy}
+                if (quirks.shift_vy)
+                {
+                    assembler.alu(mov, eax, vy);
+                    assembler.alu(mov, vx, eax);
+                    assembler.shift(shr_digit, vx, 1);
+                    assembler.alu(and_digit, eax, 0x1u);
+                    assembler.alu(mov, vf, eax);
+                }
+                else
+                {
+                    assembler.alu(mov, edx, vx);
+                    assembler.alu(and_digit, edx, 0x1u);
+                    assembler.alu(mov, vf, edx);
+                    assembler.shift(shr_digit, vx, 1);
+                }
+                break;
+            case 0x7: // SUBN Vx, Vy, VF = NOT borrow
+                assembler.alu(xor_, edx, edx);
+                assembler.alu(cmp, vy, vx);
+                assembler.set(above, edx);
+                assembler.alu(mov, vf, edx);
+                assembler.alu(mov, eax, vy);
+                assembler.alu(sub, eax, vx);
+                assembler.alu(and_digit, eax, 0xFFu);
+                assembler.alu(mov, vx, eax);
+                break;
+            default: // 8xyE - SHL Vx {, Vy}
+                if (quirks.shift_vy)
+                {
+                    assembler.alu(mov, eax, vy);
+                    assembler.alu(mov, vx, eax);
+                    assembler.shift(shl_digit, vx, 1);
+                    assembler.alu(and_digit, vx, 0xFFu);
+                    assembler.shift(shr_digit, eax, 7);
+                    assembler.alu(mov, vf, eax);
+                }
+                else
+                {
+                    assembler.alu(mov, edx, vx);
+                    assembler.shift(shr_digit, edx, 7);
+                    assembler.alu(mov, vf, edx);
+                    assembler.shift(shl_digit, vx, 1);
+                    assembler.alu(and_digit, vx, 0xFFu);
+                }
+                break;
+            }
+            break;
+        case 0xA000: // LD I, nnn
+            assembler.store_word(layout.address_register, static_cast<uint16_t>(opcode & 0x0FFF));
+            break;
+        default: // Fx1E - ADD I, Vx, VF = I + Vx > 0xFFF
+            assembler.load_word(eax, layout.address_register);
+            assembler.alu(mov, edx, eax);
+            assembler.alu(add, edx, vx);
+            assembler.alu(xor_, ecx, ecx);
+            assembler.alu(cmp_digit, edx, 0x0FFFu);
+            assembler.set(above, ecx);
+            assembler.alu(mov, vf, ecx);
+            assembler.alu(add, eax, vx);
+            assembler.store_word(eax, layout.address_register);
+            break;
+        }
+    }
+}
+#endif
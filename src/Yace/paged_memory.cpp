@@ -0,0 +1,55 @@
+#include "Yace/paged_memory.hpp"
+
+#include <algorithm>
+
+namespace ye
+{
+    paged_memory::paged_memory()
+    {
+        // Every page starts out as the same zeroed page, which is never written to as this reference keeps it shared
+        static auto const zero_page = std::make_shared<page>(page{{0}});
+        pages_.fill(zero_page);
+    }
+
+    void paged_memory::write(size_t const address, uint8_t const value)
+    {
+        const auto wrapped = address & address_mask;
+        get_writable_page(wrapped / page_size).bytes[wrapped % page_size] = value;
+    }
+
+    void paged_memory::write(size_t address, uint8_t const* data, size_t size)
+    {
+        while (size > 0)
+        {
+            address &= address_mask;
+            const auto offset = address % page_size;
+            const auto count = std::min(size, page_size - offset);
+            auto& page = get_writable_page(address / page_size);
+            std::copy(data, data + count, page.bytes.begin() + offset);
+
+            address += count;
+            data += count;
+            size -= count;
+        }
+    }
+
+    uint8_t const* paged_memory::get_page(size_t const index) const
+    {
+        return pages_[index]->bytes.data();
+    }
+
+    size_t paged_memory::size() const
+    {
+        return page_size * page_count;
+    }
+
+    paged_memory::page& paged_memory::get_writable_page(size_t const index)
+    {
+        // Copy on write, a page nobody else references is written in place
+        auto& page = pages_[index];
+        if (page.use_count() > 1)
+            page = std::make_shared<paged_memory::page>(*page);
+
+        return *page;
+    }
+}
@@ -0,0 +1,199 @@
+#include "Yace/recompiler.hpp"
+
+#include <array>
+#include <vector>
+#include "Yace/chip8.hpp"
+#include "Yace/native_code.hpp"
+
+namespace priv
+{
+    size_t const max_block_size = 64;
+
+    size_t const min_native_size = 3; // shorter runs are faster through their handlers than through a call
+}
+
+namespace ye
+{
+    // Either a compiled run of instructions or a single decoded one
+    struct recompiler::step
+    {
+        native_code::function native;
+
+        chip8::instruction instruction;
+    };
+
+    struct recompiler::block
+    {
+        uint16_t address;
+
+        size_t size; // in instructions
+
+        std::vector<step> steps;
+
+        std::array<block*, 2> links; // successors this block has already jumped to
+    };
+
+    recompiler::recompiler(chip8& chip8) :
+        chip8_(chip8),
+        native_(native_code::is_available() ? new native_code() : nullptr),
+        next_(nullptr),
+        flush_pending_(false)
+    {
+    }
+
+    recompiler::~recompiler() = default;
+
+    void recompiler::execute(uint64_t const budget)
+    {
+        // A store executed by the interpreter fallback below may have hit translated code
+        if (flush_pending_)
+            flush();
+
+        if (!next_ || next_->address != chip8_.state_.pc)
+            next_ = &find_block(chip8_.state_.pc);
+
+        // Nothing translates at the end of the memory, the interpreter reports the bad pc
+        auto& block = *next_;
+        if (block.size == 0 || block.size > budget)
+        {
+            chip8_.execute_instruction();
+            return;
+        }
+
+        for (auto const& step : block.steps)
+        {
+            if (step.native)
+            {
+                step.native(&chip8_.state_);
+                continue;
+            }
+
+            chip8_.state_.opcode = step.instruction.opcode;
+            (chip8_.*step.instruction.execute)(step.instruction);
+            ++chip8_.state_.cycles;
+        }
+
+        // Stores end a block, so the block that wrote into translated code is never resumed
+        if (flush_pending_)
+            flush();
+        else
+            next_ = &link(block, chip8_.state_.pc);
+    }
+
+    void recompiler::invalidate(uint16_t const address, uint16_t const size)
+    {
+        for (size_t i = address; i < address + size && i < code_.size(); ++i)
+            if (code_[i])
+            {
+                flush_pending_ = true;
+                break;
+            }
+    }
+
+    void recompiler::flush()
+    {
+        blocks_.clear();
+        if (native_)
+            native_->clear();
+        code_.reset();
+        next_ = nullptr;
+        flush_pending_ = false;
+    }
+
+    recompiler::block& recompiler::find_block(uint16_t const address)
+    {
+        auto& block = blocks_[address];
+        if (!block)
+            block = translate(address);
+
+        return *block;
+    }
+
+    recompiler::block& recompiler::link(block& block, uint16_t const address)
+    {
+        for (auto const successor : block.links)
+            if (successor && successor->address == address)
+                return *successor;
+
+        auto& successor = find_block(address);
+        for (auto& link : block.links)
+            if (!link)
+            {
+                link = &successor;
+                break;
+            }
+
+        return successor;
+    }
+
+    std::unique_ptr<recompiler::block> recompiler::translate(uint16_t const address)
+    {
+        std::unique_ptr<block> block(new recompiler::block());
+        block->address = address;
+        block->size = 0;
+        block->links = {nullptr, nullptr};
+
+        std::vector<chip8::instruction> instructions;
+        auto const& memory = chip8_.state_.memory;
+        size_t current = address;
+        while (current + 1 < memory.size() && instructions.size() < priv::max_block_size)
+        {
+            const auto instruction = chip8_.decode_instruction(
+                static_cast<uint16_t>(memory[current] << 8 | memory[current + 1]));
+            instructions.push_back(instruction);
+            current += 2;
+
+            // Bnnn and Fx55 have one handler per quirks profile, they are recognized by their opcode
+            const auto execute = instruction.execute;
+            if (execute == &chip8::jump ||
+                execute == &chip8::call ||
+                execute == &chip8::return_from_subroutine ||
+                (instruction.opcode & 0xF000) == 0xB000 ||
+                execute == &chip8::skip_if_equal_byte ||
+                execute == &chip8::skip_if_not_equal_byte ||
+                execute == &chip8::skip_if_equal_register ||
+                execute == &chip8::skip_if_not_equal_register ||
+                execute == &chip8::skip_if_key_pressed ||
+                execute == &chip8::skip_if_key_not_pressed ||
+                execute == &chip8::wait_key ||
+                execute == &chip8::store_bcd ||
+                (instruction.opcode & 0xF0FF) == 0xF055 ||
+                execute == &chip8::invalid)
+                break;
+        }
+
+        for (auto i = static_cast<size_t>(address); i < current; ++i)
+            code_[i] = true;
+
+        // Runs of instructions native code supports become one step, a skip can only end a block and so a run
+        block->size = instructions.size();
+        std::vector<uint16_t> opcodes;
+        for (size_t i = 0; i < instructions.size();)
+        {
+            opcodes.clear();
+            if (native_)
+                while (i + opcodes.size() < instructions.size() &&
+                       native_code::is_supported(instructions[i + opcodes.size()].opcode))
+                    opcodes.push_back(instructions[i + opcodes.size()].opcode);
+
+            auto count = opcodes.size();
+            native_code::function native = nullptr;
+            if (count >= priv::min_native_size)
+                native = native_->compile(static_cast<uint16_t>(address + i * 2), opcodes.data(), count,
+                                          chip8_.quirks_);
+
+            if (native && count >= priv::min_native_size)
+            {
+                block->steps.push_back({native, instructions[i]});
+                i += count;
+            }
+            else
+            {
+                block->steps.push_back({nullptr, instructions[i]});
+                ++i;
+            }
+        }
+
+        return block;
+    }
+}
@@ -9,17 +9,23 @@ namespace priv
     void destroy(GLFWwindow* glfw_window);
 
     void window_size_callback(GLFWwindow* glfw_window, int width, int height);
+
+    void window_refresh_callback(GLFWwindow* glfw_window);
 }
 
 namespace ye
 {
     window::window(uint32_t const width, uint32_t const height, std::string const& title) :
-        glfw_window_(nullptr, priv::destroy)
+        glfw_window_(nullptr, priv::destroy),
+        damaged_(true)
     {
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, YACE_OPENGL_MAJOR);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, YACE_OPENGL_MINOR);
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifndef NDEBUG
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE); // see the KHR_debug callback of the application
+#endif
 
         glfw_window_.reset(glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr));
         if (!glfw_window_.get())
@@ -29,6 +35,7 @@ namespace ye
 
         glfwSetWindowUserPointer(glfw_window_.get(), this);
         glfwSetWindowSizeCallback(glfw_window_.get(), priv::window_size_callback);
+        glfwSetWindowRefreshCallback(glfw_window_.get(), priv::window_refresh_callback);
     }
 
     GLFWwindow& window::get_glfw_window() const
@@ -43,12 +50,41 @@ namespace ye
 
     void window::set_title(std::string const& title) const
     {
-        glfwSetWindowTitle(glfw_window_.get(), title.c_str());
+        {
+            std::lock_guard<std::mutex> lock(title_mutex_);
+            title_.reset(new std::string(title));
+        }
+        glfwPostEmptyEvent();
+    }
+
+    void window::update() const
+    {
+        std::unique_ptr<std::string> title;
+        {
+            std::lock_guard<std::mutex> lock(title_mutex_);
+            title.swap(title_);
+        }
+        if (title)
+            glfwSetWindowTitle(glfw_window_.get(), title->c_str());
     }
 
     void window::resize(uint32_t const width, uint32_t const height) const
     {
         glViewport(0, 0, width, height);
+        damage();
+    }
+
+    bool window::was_damaged() const
+    {
+        const auto damaged = damaged_;
+        damaged_ = false;
+
+        return damaged;
+    }
+
+    void window::damage() const
+    {
+        damaged_ = true;
     }
 }
 
@@ -63,4 +99,9 @@ namespace priv
     {
         static_cast<ye::window*>(glfwGetWindowUserPointer(glfw_window))->resize(width, height);
     }
+
+    void window_refresh_callback(GLFWwindow* glfw_window)
+    {
+        static_cast<ye::window*>(glfwGetWindowUserPointer(glfw_window))->damage();
+    }
 }
@@ -0,0 +1,428 @@
+#include <array>
+#include <cstdio>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Yace/chip8.hpp"
+#include "Yace/env_pool.hpp"
+#include "Yace/loader.hpp"
+#include "Yace/lockstep_interpreter.hpp"
+
+// Differential tests: every engine, the idle loop skipping of run_cycles() and the lockstep interpreter have to leave
+// exactly the state the interpreter leaves when it is stepped one instruction at a time.
+namespace priv
+{
+    std::array<char const*, 23> const roms = {
+        "15PUZZLE", "BLINKY", "BLITZ", "BRIX", "CONNECT4", "GUESS", "HIDDEN", "INVADERS", "KALEID", "MAZE", "MERLIN",
+        "MISSILE", "PONG", "PONG2", "PUZZLE", "SYZYGY", "TANK", "TETRIS", "TICTAC", "UFO", "VBRIX", "VERS", "WIPEOFF"};
+
+    // Compiled by yace_add_compiled_rom() in CMakeLists.txt
+    std::array<char const*, 3> const compiled_roms = {"BRIX", "PONG", "TICTAC"};
+
+    std::array<ye::quirks_profile, 3> const quirks = {
+        ye::quirks_profile::yace, ye::quirks_profile::cosmac, ye::quirks_profile::superchip};
+
+    int failures = 0;
+
+    void check(bool condition, std::string const& test);
+
+    bool is_same(ye::state const& x, ye::state const& y);
+
+    std::string get_name(ye::engine engine, ye::quirks_profile quirks);
+
+    void compare_engine(std::string const& rom, std::vector<uint8_t> const& program, ye::engine engine,
+                        ye::quirks_profile quirks);
+
+    void compare_random_programs(size_t count);
+
+    void check_unbounded_budgets(std::vector<uint8_t> const& program);
+
+    void check_idle_loop_stack();
+
+    void check_pool_reset(std::vector<uint8_t> const& program);
+
+    void compare_lockstep(std::string const& rom, std::vector<uint8_t> const& program);
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string resources = argc > 1 ? argv[1] : "resources";
+
+    try
+    {
+        for (auto const rom : priv::roms)
+        {
+            const auto program = ye::load_resource(resources + "/" + rom);
+            for (auto const quirks : priv::quirks)
+            {
+                priv::compare_engine(rom, program, ye::engine::interpreter, quirks);
+                priv::compare_engine(rom, program, ye::engine::recompiler, quirks);
+            }
+            priv::compare_lockstep(rom, program);
+        }
+
+        for (auto const rom : priv::compiled_roms)
+            priv::compare_engine(rom, ye::load_resource(resources + "/" + rom), ye::engine::compiled,
+                                 ye::quirks_profile::yace);
+
+        priv::compare_random_programs(300);
+        priv::check_unbounded_budgets(ye::load_resource(resources + "/BRIX"));
+        priv::check_idle_loop_stack();
+        priv::check_pool_reset(ye::load_resource(resources + "/BRIX"));
+    }
+    catch (std::exception const& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (priv::failures > 0)
+    {
+        fprintf(stderr, "%d failed\n", priv::failures);
+        return 1;
+    }
+    printf("All passed\n");
+
+    return 0;
+}
+
+namespace priv
+{
+    void check(bool const condition, std::string const& test)
+    {
+        if (condition)
+            return;
+
+        ++failures;
+        fprintf(stderr, "Failed: %s\n", test.c_str());
+    }
+
+    bool is_same(ye::state const& x, ye::state const& y)
+    {
+        auto same =
+            x.registers == y.registers &&
+            x.address_register == y.address_register &&
+            x.pc == y.pc &&
+            x.opcode == y.opcode &&
+            x.stack_ptr == y.stack_ptr &&
+            x.waiting_for_key == y.waiting_for_key &&
+            x.keys == y.keys &&
+            x.cycles == y.cycles &&
+            x.next_event == y.next_event &&
+            x.delay_timer_end == y.delay_timer_end &&
+            x.sound_timer_end == y.sound_timer_end &&
+            x.random_state == y.random_state &&
+            x.timer_period == y.timer_period &&
+            x.graphics == y.graphics;
+
+        // Slots above the stack pointer are dead, the lockstep interpreter doesn't keep them
+        for (size_t i = 0; i < x.stack_ptr && same; ++i)
+            same = x.stack[i] == y.stack[i];
+        for (size_t address = 0; address < x.memory.size() && same; ++address)
+            same = x.memory[address] == y.memory[address];
+
+        return same;
+    }
+
+    std::string get_name(ye::engine const engine, ye::quirks_profile const quirks)
+    {
+        const std::array<char const*, 3> engines = {"interpreter", "recompiler", "compiled"};
+        const std::array<char const*, 3> profiles = {"yace", "cosmac", "superchip"};
+
+        return std::string(engines[static_cast<size_t>(engine)]) + "/" + profiles[static_cast<size_t>(quirks)];
+    }
+
+    // The engine runs batches through run_cycles(), the reference steps through emulate_cycle() on the interpreter,
+    // which executes exactly one instruction and never skips idle loops
+    void compare_engine(
+        std::string const& rom,
+        std::vector<uint8_t> const& program,
+        ye::engine const engine,
+        ye::quirks_profile const quirks)
+    {
+        const auto test = rom + " " + get_name(engine, quirks);
+        ye::chip8 subject;
+        ye::chip8 reference;
+        subject.set_engine(engine);
+        subject.set_quirks(quirks);
+        reference.set_quirks(quirks);
+        subject.seed(3);
+        reference.seed(3);
+        subject.load(program);
+        reference.load(program);
+
+        ye::state snapshot;
+        for (uint64_t batch = 0; batch < 60; ++batch)
+        {
+            // Halfway through both go back to an early snapshot, which brings back code a store may have replaced
+            if (batch == 1)
+                reference.save_state(snapshot);
+            if (batch == 30)
+            {
+                subject.load_state(snapshot);
+                reference.load_state(snapshot);
+            }
+
+            // A key is held for a couple of batches now and then
+            const auto keys = batch % 9 < 2 ? static_cast<uint16_t>(1 << batch / 9 % 16) : static_cast<uint16_t>(0);
+            subject.set_keys(keys);
+            reference.set_keys(keys);
+
+            const auto cycles = 1000 + batch % 7 * 333;
+            ye::state x;
+            ye::state y;
+            reference.save_state(y);
+            std::string subject_error;
+            std::string reference_error;
+            try
+            {
+                subject.run_cycles(cycles);
+            }
+            catch (std::exception const& e)
+            {
+                subject_error = e.what();
+            }
+            try
+            {
+                const auto end = y.cycles + cycles;
+                while (reference.get_cycles() < end)
+                    reference.emulate_cycle();
+            }
+            catch (std::exception const& e)
+            {
+                reference_error = e.what();
+            }
+
+            subject.save_state(x);
+            reference.save_state(y);
+            check(subject_error == reference_error, test + ": same errors");
+            check(is_same(x, y), test + ": same state after batch " + std::to_string(batch));
+            check(subject.sound_flag == reference.sound_flag, test + ": same sound");
+            if (!subject_error.empty() || !is_same(x, y))
+                return;
+            subject.sound_flag = false;
+            reference.sound_flag = false;
+        }
+    }
+
+    // Register instructions with VF as an operand, skips and I arithmetic in random order, which is what the native
+    // code of the recompiler covers
+    void compare_random_programs(size_t const count)
+    {
+        std::mt19937 generator(7);
+        for (size_t program_index = 0; program_index < count; ++program_index)
+        {
+            std::vector<uint8_t> program;
+            const auto add = [&program](uint32_t const opcode)
+            {
+                program.push_back(static_cast<uint8_t>(opcode >> 8));
+                program.push_back(static_cast<uint8_t>(opcode));
+            };
+
+            for (uint32_t x = 0; x < 16; ++x)
+                add(0x6000 | x << 8 | (generator() & 0xFF));
+            add(0xA000 | (generator() & 0xFFF));
+            const auto loop = static_cast<uint32_t>(0x200 + program.size());
+            for (auto i = 8 + generator() % 80; i > 0; --i)
+            {
+                // VF is an operand a quarter of the time
+                auto x = generator() % 16;
+                auto y = generator() % 16;
+                if (generator() % 4 == 0)
+                {
+                    x = generator() % 2 == 0 ? 0xF : x;
+                    y = generator() % 2 == 0 ? 0xF : y;
+                }
+                const std::array<uint32_t, 9> operations = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+                const uint32_t kk = generator() & 0xFF;
+                switch (generator() % 9)
+                {
+                case 0:
+                    add(0x3000 | x << 8 | kk);
+                    break;
+                case 1:
+                    add(0x4000 | x << 8 | kk);
+                    break;
+                case 2:
+                    add(0x5000 | x << 8 | y << 4);
+                    break;
+                case 3:
+                    add(0x9000 | x << 8 | y << 4);
+                    break;
+                case 4:
+                    add(0x6000 | x << 8 | kk);
+                    break;
+                case 5:
+                    add(0x7000 | x << 8 | kk);
+                    break;
+                case 6:
+                    add(0xA000 | (generator() & 0xFFF));
+                    break;
+                case 7:
+                    add(0xF01E | x << 8);
+                    break;
+                default:
+                    add(0x8000 | x << 8 | y << 4 | operations[generator() % operations.size()]);
+                    break;
+                }
+            }
+            // Twice, a skip at the end of the loop body lands on the second one
+            add(0x1000 | loop);
+            add(0x1000 | loop);
+
+            for (auto const quirks : priv::quirks)
+            {
+                const auto test = "random program " + std::to_string(program_index) + " " +
+                    get_name(ye::engine::recompiler, quirks);
+                ye::chip8 subject;
+                ye::chip8 reference;
+                subject.set_engine(ye::engine::recompiler);
+                subject.set_quirks(quirks);
+                reference.set_quirks(quirks);
+                subject.seed(5);
+                reference.seed(5);
+                subject.load(program);
+                reference.load(program);
+                for (size_t batch = 0; batch < 20; ++batch)
+                {
+                    subject.run_cycles(1 + generator() % 300);
+                    while (reference.get_cycles() < subject.get_cycles())
+                        reference.emulate_cycle();
+
+                    ye::state x;
+                    ye::state y;
+                    subject.save_state(x);
+                    reference.save_state(y);
+                    check(is_same(x, y), test + ": same state after batch " + std::to_string(batch));
+                    if (!is_same(x, y))
+                        break;
+                }
+            }
+        }
+    }
+
+    // A budget of max() once the core has run must not wrap around to a budget that is already used up
+    void check_unbounded_budgets(std::vector<uint8_t> const& program)
+    {
+        const auto max = std::numeric_limits<uint64_t>::max();
+        for (auto const engine : {ye::engine::interpreter, ye::engine::recompiler})
+        {
+            const auto test = "BRIX " + get_name(engine, ye::quirks_profile::yace);
+            ye::chip8 chip8;
+            chip8.set_engine(engine);
+            chip8.load(program);
+            chip8.run_cycles(5000);
+            chip8.redraw_flag = false;
+
+            const auto cycles = chip8.get_cycles();
+            const auto reason = chip8.run_until({max, true, false, false, std::nullopt});
+            check(reason == ye::stop_reason::redraw && chip8.get_cycles() > cycles,
+                  test + ": run_until() with an unbounded budget runs to the redraw");
+
+            chip8.tap_key(5, max);
+            chip8.run_cycles(1000);
+            check((chip8.get_keys() & 1 << 5) != 0, test + ": a key tapped for max() cycles stays held");
+        }
+    }
+
+    // The backward jump at 0x204 is reached twice with the same registers and stack pointer, but the return address
+    // below it differs, so the second time it is not an idle loop
+    void check_idle_loop_stack()
+    {
+        const std::vector<uint8_t> program = {
+            0x12, 0x06, // 0x200: JP 0x206
+            0x00, 0xEE, // 0x202: RET
+            0x12, 0x02, // 0x204: JP 0x202
+            0x22, 0x04, // 0x206: CALL 0x204
+            0x22, 0x04, // 0x208: CALL 0x204
+            0x60, 0x01, // 0x20A: LD V0, 1
+            0x12, 0x0C}; // 0x20C: JP 0x20C
+        for (auto const engine : {ye::engine::interpreter, ye::engine::recompiler})
+        {
+            ye::chip8 subject;
+            ye::chip8 reference;
+            subject.set_engine(engine);
+            subject.seed(1);
+            reference.seed(1);
+            subject.load(program);
+            reference.load(program);
+
+            subject.run_cycles(100);
+            while (reference.get_cycles() < subject.get_cycles())
+                reference.emulate_cycle();
+
+            ye::state x;
+            ye::state y;
+            subject.save_state(x);
+            reference.save_state(y);
+            check(is_same(x, y), "idle loop " + get_name(engine, ye::quirks_profile::yace) +
+                  ": a different return address is not the same loop");
+        }
+    }
+
+    // Ids are checked before any core is touched
+    void check_pool_reset(std::vector<uint8_t> const& program)
+    {
+        ye::env_pool pool(program, 4, 100, 2);
+        pool.step({0, 0, 0, 0});
+        const auto frames = pool.observe();
+
+        auto rejected = false;
+        try
+        {
+            pool.reset({0, 3, 0});
+        }
+        catch (std::invalid_argument const&)
+        {
+            rejected = true;
+        }
+        check(rejected && pool.observe() == frames, "environment pool: a core listed twice is rejected");
+    }
+
+    // Lanes start converged and are pulled apart by random keys
+    void compare_lockstep(std::string const& rom, std::vector<uint8_t> const& program)
+    {
+        const size_t size = 8;
+        ye::lockstep_interpreter subject(program, size);
+        std::unique_ptr<ye::chip8[]> references(new ye::chip8[size]);
+        for (size_t lane = 0; lane < size; ++lane)
+        {
+            references[lane].load(program);
+            references[lane].seed(lane * 7);
+            subject.seed(lane, lane * 7);
+        }
+
+        std::mt19937 generator(11);
+        for (size_t batch = 0; batch < 200; ++batch)
+        {
+            for (size_t lane = 0; lane < size; ++lane)
+            {
+                const auto keys = batch >= 50 && generator() % 5 == 0 ?
+                    static_cast<uint16_t>(1 << generator() % 16) :
+                    static_cast<uint16_t>(0);
+                subject.set_keys(lane, keys);
+                references[lane].set_keys(keys);
+            }
+
+            subject.run_cycles(97);
+            for (size_t lane = 0; lane < size; ++lane)
+            {
+                references[lane].run_cycles(97);
+
+                ye::state x;
+                ye::state y;
+                subject.save_state(lane, x);
+                references[lane].save_state(y);
+                const auto same = is_same(x, y);
+                check(same, rom + " lockstep lane " + std::to_string(lane) + ": same state after batch " +
+                    std::to_string(batch));
+                if (!same)
+                    return;
+            }
+        }
+    }
+}